@@ -0,0 +1,315 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Micro-benchmarking library
+//----------------------------------------------------------------------------------------------------------------------
+//
+// A benchmark is a function that runs its body a given number of times.  benchRun first warms it up while doubling
+// the iteration count until one call takes about K_BENCH_SAMPLE_US, then times a number of calls (samples) with that
+// iteration count.  The result holds the median, 99th percentile, minimum and median absolute deviation (MAD) of the
+// time per iteration over all the samples.  The median and MAD are used rather than the mean and standard deviation
+// because a single descheduling or page fault can make one sample many times slower than the rest.
+//
+// The time is taken with timeNow, so it uses the TSC if K_TIME_TSC is on.
+//
+// Example:
+//
+//      void benchHash(void* data, i64 iterations)
+//      {
+//          for (i64 i = 0; i < iterations; ++i)
+//          {
+//              u64 h = hash(data, 64);
+//              benchDoNotOptimize(&h);
+//          }
+//      }
+//
+//      Bench B;
+//      benchInit(&B, 0);
+//      benchSuite(&B, "hash");
+//      benchRun(&B, "64B", &benchHash, buffer, 64);
+//      benchWriteText(&B, stdout);
+//      benchDone(&B);
+//
+//----------------------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <kore/kore.h>
+#include <math.h>
+#include <string.h>
+
+#if K_COMPILER_MSVC
+#   include <intrin.h>
+#endif
+
+//----------------------------------------------------------------------------------------------------------------------
+// Configuration
+//----------------------------------------------------------------------------------------------------------------------
+
+// How long to warm up each benchmark for.
+#ifndef K_BENCH_WARMUP_MS
+#   define K_BENCH_WARMUP_MS       50
+#endif
+
+// The time a single sample should take.  Short samples are dominated by timer resolution.
+#ifndef K_BENCH_SAMPLE_US
+#   define K_BENCH_SAMPLE_US       2000
+#endif
+
+// The number of samples taken, unless they would take longer than K_BENCH_MAX_MS in total.
+#ifndef K_BENCH_SAMPLES
+#   define K_BENCH_SAMPLES         101
+#endif
+
+// The fewest samples taken, however slow the benchmark.
+#ifndef K_BENCH_MIN_SAMPLES
+#   define K_BENCH_MIN_SAMPLES     11
+#endif
+
+#ifndef K_BENCH_MAX_MS
+#   define K_BENCH_MAX_MS          2000
+#endif
+
+//----------------------------------------------------------------------------------------------------------------------
+// Benchmarks
+//----------------------------------------------------------------------------------------------------------------------
+
+// Run the code being measured iterations times.
+typedef void (*BenchFunc) (void* data, i64 iterations);
+
+typedef struct
+{
+    const char*   suite;
+    const char*   name;
+    i64         iterations;     // Iterations per sample.
+    i64         samples;
+    i64         bytes;          // Bytes processed per iteration, or 0 if it doesn't make sense.
+    f64         median;         // All times are in nanoseconds per iteration.
+    f64         p99;
+    f64         mad;
+    f64         min;
+}
+BenchResult;
+
+typedef struct
+{
+    Array(BenchResult)  results;
+    const char*           suite;
+    const char*           filter;     // Only benchmarks with this in their "suite/name" are run.  0 runs them all.
+}
+Bench;
+
+void benchInit(Bench* B, const char* filter);
+void benchDone(Bench* B);
+
+// Set the suite that the following benchmarks belong to.
+void benchSuite(Bench* B, const char* suite);
+
+// Returns YES if the benchmark passed the filter and was run.  bytes is used to work out the throughput.
+bool benchRun(Bench* B, const char* name, BenchFunc func, void* data, i64 bytes);
+
+// Returns YES if a benchmark in the current suite passes the filter, so that expensive set-up can be skipped.
+bool benchEnabled(Bench* B, const char* name);
+
+// Write the results as a table, CSV with a header line, or a JSON array of objects.
+void benchWriteText(Bench* B, FILE* f);
+void benchWriteCsv(Bench* B, FILE* f);
+void benchWriteJson(Bench* B, FILE* f);
+
+// Stop the compiler removing the calculation of *p, or assuming what memory holds across this point.
+#if K_COMPILER_MSVC
+extern const void* volatile gBenchSink;
+#   define benchDoNotOptimize(p) (gBenchSink = (const void *)(p), _ReadWriteBarrier())
+#else
+#   define benchDoNotOptimize(p) __asm__ __volatile__("" : : "r"(p) : "memory")
+#endif
+
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+// I M P L E M E N T A T I O N
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+
+#ifdef K_IMPLEMENTATION
+
+#if K_COMPILER_MSVC
+const void* volatile gBenchSink = 0;
+#endif
+
+void benchInit(Bench* B, const char* filter)
+{
+    B->results = 0;
+    B->suite = "";
+    B->filter = filter;
+}
+
+void benchDone(Bench* B)
+{
+    arrayDone(B->results);
+}
+
+void benchSuite(Bench* B, const char* suite)
+{
+    B->suite = suite;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+internal int __benchCompare(const void* a, const void* b)
+{
+    f64 x = *(const f64 *)a;
+    f64 y = *(const f64 *)b;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+internal f64 __benchMedian(const f64* sorted, i64 count)
+{
+    return (count & 1) ? sorted[count / 2] : (sorted[count / 2 - 1] + sorted[count / 2]) * 0.5;
+}
+
+internal bool __benchFiltered(Bench* B, const char* name)
+{
+    if (!B->filter) return NO;
+
+    char fullName[256];
+    snprintf(fullName, sizeof(fullName), "%s/%s", B->suite, name);
+    return K_BOOL(strstr(fullName, B->filter) == 0);
+}
+
+bool benchEnabled(Bench* B, const char* name)
+{
+    return !__benchFiltered(B, name);
+}
+
+bool benchRun(Bench* B, const char* name, BenchFunc func, void* data, i64 bytes)
+{
+    if (__benchFiltered(B, name)) return NO;
+
+    f64 nsPerTick = 1.0e9 / (f64)timeFrequency();
+    i64 sampleTicks = timeFrequency() * K_BENCH_SAMPLE_US / 1000000;
+    i64 maxTicks = timeFrequency() * K_BENCH_MAX_MS / 1000;
+
+    //
+    // Warm up, doubling the iterations until a call is long enough to be a sample.
+    //
+
+    i64 iterations = 1;
+    i64 ticks = 0;
+    TimePoint warmupEnd = timeFuture(timeNow(), timeMsecs(K_BENCH_WARMUP_MS));
+    for (;;)
+    {
+        TimePoint t0 = timeNow();
+        func(data, iterations);
+        TimePoint t1 = timeNow();
+        ticks = timePeriod(t0, t1).QuadPart;
+
+        if (ticks < sampleTicks)
+        {
+            iterations *= 2;
+        }
+        else if (t1.QuadPart >= warmupEnd.QuadPart)
+        {
+            break;
+        }
+    }
+
+    //
+    // Take the samples.
+    //
+
+    i64 numSamples = maxTicks / K_MAX(ticks, 1);
+    numSamples = K_MAX(K_MIN(numSamples, K_BENCH_SAMPLES), K_BENCH_MIN_SAMPLES);
+
+    f64* samples = K_ALLOC(sizeof(f64) * numSamples * 2);
+    f64* deviations = samples + numSamples;
+    for (i64 i = 0; i < numSamples; ++i)
+    {
+        TimePoint t0 = timeNow();
+        func(data, iterations);
+        TimePoint t1 = timeNow();
+        samples[i] = (f64)timePeriod(t0, t1).QuadPart * nsPerTick / (f64)iterations;
+    }
+
+    sortInPlace(samples, numSamples, sizeof(f64), &__benchCompare);
+    f64 median = __benchMedian(samples, numSamples);
+    for (i64 i = 0; i < numSamples; ++i) deviations[i] = fabs(samples[i] - median);
+    sortInPlace(deviations, numSamples, sizeof(f64), &__benchCompare);
+
+    BenchResult* r = arrayNew(B->results);
+    r->suite = B->suite;
+    r->name = name;
+    r->iterations = iterations;
+    r->samples = numSamples;
+    r->bytes = bytes;
+    r->median = median;
+    r->p99 = samples[(numSamples * 99 + 99) / 100 - 1];
+    r->mad = __benchMedian(deviations, numSamples);
+    r->min = samples[0];
+
+    K_FREE(samples, sizeof(f64) * numSamples * 2);
+    return YES;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+internal f64 __benchMBPerSec(BenchResult* r)
+{
+    return r->bytes ? ((f64)r->bytes * 1.0e9 / r->median) / (1024.0 * 1024.0) : 0.0;
+}
+
+internal const char* __benchTime(char* buffer, f64 ns)
+{
+    if (ns < 1.0e3)         sprintf(buffer, "%.2fns", ns);
+    else if (ns < 1.0e6)    sprintf(buffer, "%.2fus", ns / 1.0e3);
+    else if (ns < 1.0e9)    sprintf(buffer, "%.2fms", ns / 1.0e6);
+    else                    sprintf(buffer, "%.2fs", ns / 1.0e9);
+    return buffer;
+}
+
+void benchWriteText(Bench* B, FILE* f)
+{
+    char median[32], p99[32], mad[32], min[32];
+
+    fprintf(f, "%-16s %-24s %12s %12s %12s %12s %12s\n", "suite", "name", "median", "p99", "mad", "min", "MB/s");
+    for (i64 i = 0; i < arrayCount(B->results); ++i)
+    {
+        BenchResult* r = &B->results[i];
+        fprintf(f, "%-16s %-24s %12s %12s %12s %12s ", r->suite, r->name,
+            __benchTime(median, r->median), __benchTime(p99, r->p99), __benchTime(mad, r->mad),
+            __benchTime(min, r->min));
+        if (r->bytes)
+        {
+            fprintf(f, "%12.1f\n", __benchMBPerSec(r));
+        }
+        else
+        {
+            fprintf(f, "%12s\n", "-");
+        }
+    }
+}
+
+void benchWriteCsv(Bench* B, FILE* f)
+{
+    fprintf(f, "suite,name,iterations,samples,bytes,median_ns,p99_ns,mad_ns,min_ns,mb_per_sec\n");
+    for (i64 i = 0; i < arrayCount(B->results); ++i)
+    {
+        BenchResult* r = &B->results[i];
+        fprintf(f, "%s,%s,%lld,%lld,%lld,%.3f,%.3f,%.3f,%.3f,%.3f\n", r->suite, r->name, (long long)r->iterations,
+            (long long)r->samples, (long long)r->bytes, r->median, r->p99, r->mad, r->min, __benchMBPerSec(r));
+    }
+}
+
+void benchWriteJson(Bench* B, FILE* f)
+{
+    // Suite and benchmark names are identifiers, so they are not escaped.
+    fprintf(f, "[\n");
+    for (i64 i = 0; i < arrayCount(B->results); ++i)
+    {
+        BenchResult* r = &B->results[i];
+        fprintf(f, "  {\"suite\":\"%s\",\"name\":\"%s\",\"iterations\":%lld,\"samples\":%lld,\"bytes\":%lld,"
+            "\"median_ns\":%.3f,\"p99_ns\":%.3f,\"mad_ns\":%.3f,\"min_ns\":%.3f,\"mb_per_sec\":%.3f}%s\n",
+            r->suite, r->name, (long long)r->iterations, (long long)r->samples, (long long)r->bytes,
+            r->median, r->p99, r->mad, r->min, __benchMBPerSec(r), i + 1 < arrayCount(B->results) ? "," : "");
+    }
+    fprintf(f, "]\n");
+}
+
+#endif // K_IMPLEMENTATION
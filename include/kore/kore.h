@@ -16,9 +16,11 @@
 
 // Compiler defines
 #define K_COMPILER_MSVC     NO
+#define K_COMPILER_GCC      NO
 
 // OS defines
 #define K_OS_WIN32          NO
+#define K_OS_LINUX          NO
 
 // CPU defines
 #define K_CPU_X86           NO
@@ -38,6 +40,9 @@
 #ifdef _MSC_VER
 #   undef K_COMPILER_MSVC
 #   define K_COMPILER_MSVC YES
+#elif defined(__GNUC__)
+#   undef K_COMPILER_GCC
+#   define K_COMPILER_GCC YES
 #else
 #   error Unknown compiler.  Please define COMPILE_XXX macro for your compiler.
 #endif
@@ -48,6 +53,9 @@
 #ifdef _WIN32
 #   undef K_OS_WIN32
 #   define K_OS_WIN32 YES
+#elif defined(__linux__)
+#   undef K_OS_LINUX
+#   define K_OS_LINUX YES
 #else
 #   error Unknown OS.  Please define OS_XXX macro for your operating system.
 #endif
@@ -63,7 +71,17 @@
 #       undef K_CPU_X86
 #       define K_CPU_X86 YES
 #   else
-#       error Can not determine processor - something's gone very wrong here!
+#       error Can not determine processor - something has gone very wrong here!
+#   endif
+#elif K_COMPILER_GCC
+#   if defined(__x86_64__)
+#       undef K_CPU_X64
+#       define K_CPU_X64 YES
+#   elif defined(__i386__)
+#       undef K_CPU_X86
+#       define K_CPU_X86 YES
+#   else
+#       error Can not determine processor - something has gone very wrong here!
 #   endif
 #else
 #   error Add CPU determination code for your compiler.
@@ -90,6 +108,9 @@
 #   ifdef _DEBUG
 #       include <crtdbg.h>
 #   endif
+#elif K_OS_LINUX
+#   include <stdarg.h>
+#   include <string.h>
 #endif
 
 #include <assert.h>
@@ -97,6 +118,10 @@
 #include <stdio.h>
 #include <stdint.h>
 
+#if K_CPU_X86 || K_CPU_X64
+#   include <emmintrin.h>
+#endif
+
 //----------------------------------------------------------------------------------------------------------------------
 //----------------------------------------------------------------------------------------------------------------------
 // Debugging
@@ -159,12 +184,45 @@ typedef char        bool;
 
 #define internal static
 
+#if K_COMPILER_MSVC
+#   define K_THREAD_LOCAL __declspec(thread)
+#else
+#   define K_THREAD_LOCAL __thread
+#endif
+
 #define K_ZERO(d) memset(&(d), 0, sizeof(d))
 
 #define K_BITCAST(type, value) (*(type *)&(value))
 
 #define K_INRANGE(var, a, b) ((slot) >= (a) && (slot) < (b))
 
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+// Atomic operations
+//
+// All operate on aligned 64-bit integers and are sequentially consistent.  K_ATOMIC_ADD and K_ATOMIC_CAS return the
+// value before the operation.  The _PTR versions operate on pointers.  K_ATOMIC_FENCE is a full memory barrier.
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+
+#if K_COMPILER_MSVC
+#   define K_ATOMIC_LOAD(p)                     (*(volatile i64 *)(p))
+#   define K_ATOMIC_STORE(p, v)                 InterlockedExchange64((volatile LONG64 *)(p), (v))
+#   define K_ATOMIC_ADD(p, v)                   InterlockedExchangeAdd64((volatile LONG64 *)(p), (v))
+#   define K_ATOMIC_CAS(p, expected, desired)   InterlockedCompareExchange64((volatile LONG64 *)(p), (desired), (expected))
+#   define K_ATOMIC_LOAD_PTR(p)                 (*(void* volatile *)(p))
+#   define K_ATOMIC_CAS_PTR(p, expected, desired)   InterlockedCompareExchangePointer((void* volatile *)(p), (desired), (expected))
+#   define K_ATOMIC_FENCE()                     MemoryBarrier()
+#else
+#   define K_ATOMIC_LOAD(p)                     __atomic_load_n((volatile i64 *)(p), __ATOMIC_SEQ_CST)
+#   define K_ATOMIC_STORE(p, v)                 __atomic_store_n((volatile i64 *)(p), (v), __ATOMIC_SEQ_CST)
+#   define K_ATOMIC_ADD(p, v)                   __atomic_fetch_add((volatile i64 *)(p), (v), __ATOMIC_SEQ_CST)
+#   define K_ATOMIC_CAS(p, expected, desired)   __sync_val_compare_and_swap((volatile i64 *)(p), (expected), (desired))
+#   define K_ATOMIC_LOAD_PTR(p)                 __atomic_load_n((void* volatile *)(p), __ATOMIC_SEQ_CST)
+#   define K_ATOMIC_CAS_PTR(p, expected, desired)   __sync_val_compare_and_swap((void* volatile *)(p), (expected), (desired))
+#   define K_ATOMIC_FENCE()                     __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#endif
+
 //----------------------------------------------------------------------------------------------------------------------
 //----------------------------------------------------------------------------------------------------------------------
 // Memory API
@@ -179,8 +237,47 @@ typedef char        bool;
 #   define K_ARENA_ALIGN       8
 #endif
 
+#ifndef K_MEMORY_SLAB
+#   define K_MEMORY_SLAB       NO
+#endif
+
+#ifndef K_MEMORY_SLAB_CHUNK
+#   define K_MEMORY_SLAB_CHUNK K_KB(64)
+#endif
+
+#ifndef K_MEMORY_PROFILE
+#   define K_MEMORY_PROFILE    NO
+#endif
+
+#ifndef K_MEMORY_PROFILE_SITES
+#   define K_MEMORY_PROFILE_SITES  4096
+#endif
+
+#ifndef K_ARENA_RESERVE
+#   define K_ARENA_RESERVE     K_GB((i64)64)
+#endif
+
+#ifndef K_ARENA_COMMIT
+#   define K_ARENA_COMMIT      K_KB(64)
+#endif
+
+#ifndef K_ARENA_HUGE_PAGE
+#   define K_ARENA_HUGE_PAGE   K_MB(2)
+#endif
+
+#ifndef K_ARENA_CACHE_SIZE
+#   define K_ARENA_CACHE_SIZE  K_KB(16)
+#endif
+
+#ifndef K_ARENA_CACHE_COUNT
+#   define K_ARENA_CACHE_COUNT 4
+#endif
+
 //----------------------------------------------------------------------------------------------------------------------
 // Basic allocation
+//
+// The size passed to memoryRealloc and memoryFree must be the size the block was allocated with.  Define
+// K_MEMORY_SLAB to YES to allocate blocks of up to 1K from a size-class slab allocator instead of the C runtime.
 
 void* memoryAlloc(i64 numBytes, const char* file, int line);
 void* memoryAllocClear(i64 numBytes, const char* file, int line);
@@ -199,26 +296,97 @@ void memoryClear(void* mem, i64 numBytes);
 
 //----------------------------------------------------------------------------------------------------------------------
 // Arena allocation
+//
+// An arena is one of these types:
+//
+//      AT_Realloc      A single contiguous block that is grown by reallocating.  Previous allocations may move, but
+//                      offsets from start remain valid (string tables rely on this).
+//      AT_Chained      A linked list of blocks that double in size.  Growth never copies and previous allocations
+//                      never move, but the memory is not contiguous.
+//      AT_Virtual      A large range of address space is reserved up front and pages are committed as the cursor
+//                      advances.  Growth never copies, start never moves and the memory is contiguous.
+//      AT_Concurrent   A chain of blocks that many threads can allocate from at the same time.  Allocations never
+//                      move, but there are no restore points.  Free everything in one go with arenaDone once all
+//                      threads have finished with it.
+//      AT_Mapped       A read-only arena image mapped from a file by arenaMap.  It cannot be allocated from.
+//
+// For chained arenas, start and end describe the current block and cursor is an offset into it.  Restore points are
+// stored as offsets into the whole chain so that arenaPop can unwind across block boundaries.
+//
+// For virtual arenas, end is the end of the committed pages and limit is the end of the reserved range.  If highWater
+// is non-zero, arenaPop will decommit any pages beyond both the cursor and the high-water mark so that memory is given
+// back to the OS after a spike.
+//
+// Huge arenas are virtual arenas backed by K_ARENA_HUGE_PAGE pages to cut down TLB misses on very large arenas.  Explicit
+// huge pages (MAP_HUGETLB on Linux, MEM_LARGE_PAGES on Windows) are tried first and are committed up front, so they
+// only succeed if the OS has enough of them reserved.  Otherwise, Linux falls back to transparent huge pages and Windows
+// falls back to normal pages.  Huge arenas never decommit.
+//
+// Each arena has its own alignment for arenaAlign and arenaAlignedAlloc, which defaults to K_ARENA_ALIGN.  Alignment is
+// applied to the cursor, so every arena's memory starts on a 64-byte boundary and alignments up to 64 bytes work.
+//
+// Concurrent arenas are lock-free.  Each thread carves K_ARENA_CACHE_SIZE chunks from the shared block with an atomic
+// add and serves small allocations from its chunk, so threads rarely touch the shared cursor.  When a block fills, the
+// first thread to notice chains on a new block with a compare-and-swap.  A thread caches chunks for up to
+// K_ARENA_CACHE_COUNT concurrent arenas at once, and allocates from any others on the shared block directly.  A thread
+// gives up its cache slot for an arena when it calls arenaDone on it.
+//
+// arenaSave writes an arena's allocations to a file with a header containing a version, the size and a CRC, and
+// arenaMap maps it back.  Only offsets from start survive the round trip, so this is only useful for position-independent
+// data such as string tables.
+
+typedef enum
+{
+    AT_Realloc,
+    AT_Chained,
+    AT_Virtual,
+    AT_Concurrent,
+    AT_Mapped,
+}
+ArenaType;
 
 typedef struct
 {
-    u8*     start;
-    u8*     end;
-    i64     cursor;
-    i64     restore;
+    u8*         start;
+    u8*         end;
+    i64         cursor;
+    i64         restore;
+    ArenaType   type;
+    u8*         limit;          // AT_Virtual: end of the reserved address range.  AT_Mapped: end of the mapping.
+    i64         highWater;      // AT_Virtual: offset above which pages are decommitted by arenaPop (0 = never).
+    i64         align;          // Alignment used by arenaAlign.
+    bool        hugePages;      // AT_Virtual: pages are committed in K_ARENA_HUGE_PAGE units.
+    i64         id;             // AT_Concurrent: unique ID used to validate per-thread caches.
 }
 Arena;
 
 // Create a new Arena.
 void arenaInit(Arena* arena, i64 initialSize);
 
+// Create a new chained Arena whose first block is blockSize bytes.
+void arenaInitChained(Arena* arena, i64 blockSize);
+
+// Create a new virtual Arena that reserves reserveSize bytes of address space (usually K_ARENA_RESERVE).  Pass a
+// highWater of 0 to never decommit.
+void arenaInitVirtual(Arena* arena, i64 reserveSize, i64 highWater);
+
+// Create a new concurrent Arena whose blocks are blockSize bytes.  Only arenaAlloc, arenaAlignedAlloc and arenaDone
+// can be used on it.
+void arenaInitConcurrent(Arena* arena, i64 blockSize);
+
+// Create a new virtual Arena backed by huge pages where possible.
+void arenaInitHuge(Arena* arena, i64 reserveSize);
+
+// Set the alignment used by arenaAlign and arenaAlignedAlloc.  Must be a power of 2 no larger than 64.
+void arenaSetAlign(Arena* arena, i64 align);
+
 // Deallocate the memory used by the arena.
 void arenaDone(Arena* arena);
 
 // Allocate some memory on the arena.
 void* arenaAlloc(Arena* arena, i64 numytes);
 
-// Ensure that the next allocation is aligned to 16 bytes boundary.
+// Ensure that the next allocation is aligned to the arena's alignment.
 void* arenaAlign(Arena* arena);
 
 // Combine alignment and allocation into one function for convenience.
@@ -230,9 +398,16 @@ void arenaPush(Arena* arena);
 // Deallocate memory from the previous restore point.
 void arenaPop(Arena* arena);
 
-// Return the amount of space left in the current arena (before expansion is required).
+// Return the amount of space left in the current arena (or current block if chained) before expansion is required.
 i64 arenaSpace(Arena* arena);
 
+// Write all the allocations in an arena to a file.  Concurrent arenas cannot be saved.  Returns NO on failure.
+bool arenaSave(Arena* arena, const char* fileName);
+
+// Map an arena image written by arenaSave.  Returns NO if the file cannot be read or fails the header checks.  Release
+// it with arenaDone.
+bool arenaMap(Arena* arena, const char* fileName);
+
 // Add characters according to the printf-style format.
 char* arenaFormatV(Arena* arena, const char* format, va_list args);
 
@@ -241,6 +416,46 @@ char* arenaFormat(Arena* arena, const char* format, ...);
 
 #define K_ARENA_ALLOC(arena, t, count) (t *)arenaAlignedAlloc((arena), sizeof(t) * (count))
 
+//----------------------------------------------------------------------------------------------------------------------
+// Scratch arenas
+//
+// Each thread owns K_SCRATCH_COUNT virtual arenas for temporary allocations.  scratchBegin pushes a restore point on
+// one of them and scratchEnd pops it, so a temporary allocation costs a pointer bump and never touches the heap.
+//
+// Pass the arena you are building results on as the conflict (or 0 if none).  A different scratch arena will be
+// returned so that popping the scratch arena never destroys the results.  Scratch allocations must be ended in reverse
+// order that they began.
+//
+// Use:
+//
+//      Scratch scratch = scratchBegin(0);
+//      String msg = arenaStringFormat(scratch.arena, "%s", ...);
+//      scratchEnd(scratch);
+//----------------------------------------------------------------------------------------------------------------------
+
+#ifndef K_SCRATCH_COUNT
+#   define K_SCRATCH_COUNT     2
+#endif
+
+#ifndef K_SCRATCH_HIGHWATER
+#   define K_SCRATCH_HIGHWATER K_MB(1)
+#endif
+
+typedef struct
+{
+    Arena*  arena;
+}
+Scratch;
+
+// Obtain a scratch arena for this thread that is not the conflict arena.
+Scratch scratchBegin(Arena* conflict);
+
+// Release all allocations made on the scratch arena since scratchBegin.
+void scratchEnd(Scratch scratch);
+
+// Release the memory used by this thread's scratch arenas.  Call before a thread exits.
+void scratchDone();
+
 //----------------------------------------------------------------------------------------------------------------------
 // Arrays
 
@@ -248,8 +463,30 @@ char* arenaFormat(Arena* arena, const char* format, ...);
 
 #define K_ARRAY_COUNT(a) (sizeof(a) / sizeof((a)[0]))
 
+// Create an empty array with room for n elements whose storage comes from an arena rather than the heap.  It grows
+// in place while it is the last allocation on the arena, otherwise it is copied to a new allocation on the same arena.
+// The memory is released by arenaPop or arenaDone, and arrayDone just forgets the array.  Growing an array on a realloc
+// arena moves the other allocations on it, so prefer chained or virtual arenas.
+#define arrayInitArena(a, arena, n) ((a) = __arrayInternalInitArena((arena), (n), sizeof(*(a))))
+
+// Declare inline storage for an array of up to n elements, usually as a local variable.  Use:
+//
+//      ArrayInline(int, 16) buffer;
+//      Array(int) a = 0;
+//      arrayInitInline(a, buffer);
+//
+// The array uses the inline storage until it overflows, and then moves to the heap.  The storage must outlive the array
+// and must not be copied.  Always call arrayDone on the array.
+#define ArrayInline(T, n) struct { i64 header[2]; T data[n]; }
+
+// Make an array use inline storage declared with ArrayInline.  The header is written just before data rather than into
+// header, because a T aligned to more than 16 bytes leaves padding between them.
+#define arrayInitInline(a, buffer) \
+    (((i64 *)(buffer).data)[-2] = K_ARRAY_COUNT((buffer).data) | K_ARRAY_INLINE, ((i64 *)(buffer).data)[-1] = 0, \
+     (a) = (buffer).data)
+
 // Destroy an array.
-#define arrayDone(a) ((a) = ((a) ? K_FREE((u8 *)a - (sizeof(i64) * 2), (sizeof(*a) * __arrayCapacity(a)) + (sizeof(i64) * 2)), (void *)0 : (void *)0))
+#define arrayDone(a) ((a) = ((a) ? (!__arrayIsHeap(a) ? (void)0 : K_FREE((u8 *)a - (sizeof(i64) * 2), (sizeof(*a) * __arrayCapacity(a)) + (sizeof(i64) * 2))), (void *)0 : (void *)0))
 
 // Add an element to the end of an array and return the value.
 #define arrayAdd(a, v) (__arrayMayGrow(a, 1), (a)[__arrayCount(a)++] = (v))
@@ -297,15 +534,59 @@ char* arenaFormat(Arena* arena, const char* format, ...);
 // Internal routines
 //
 
+// Arena arrays set K_ARRAY_ARENA in the capacity and have the arena pointer and a spare word before the header.  Arrays
+// still using inline storage set K_ARRAY_INLINE.
+#define K_ARRAY_ARENA ((i64)1 << 62)
+#define K_ARRAY_INLINE ((i64)1 << 61)
+
 #define __arrayRaw(a) ((i64 *)(a) - 2)
 #define __arrayCount(a) __arrayRaw(a)[1]
-#define __arrayCapacity(a) __arrayRaw(a)[0]
+#define __arrayCapacity(a) (__arrayRaw(a)[0] & ~(K_ARRAY_ARENA | K_ARRAY_INLINE))
+#define __arrayIsArena(a) (__arrayRaw(a)[0] & K_ARRAY_ARENA)
+#define __arrayIsInline(a) (__arrayRaw(a)[0] & K_ARRAY_INLINE)
+#define __arrayIsHeap(a) (!(__arrayRaw(a)[0] & (K_ARRAY_ARENA | K_ARRAY_INLINE)))
+#define __arrayArena(a) (*(Arena **)((i64 *)(a) - 4))
 
 #define __arrayNeedsToGrow(a, n) ((a) == 0 || __arrayCount(a) + (n) > __arrayCapacity(a))
 #define __arrayMayGrow(a, n) (__arrayNeedsToGrow(a, (n)) ? __arrayGrow(a, n) : 0)
 #define __arrayGrow(a, n) ((a) = __arrayInternalGrow((a), (n), sizeof(*(a))))
 
 void* __arrayInternalGrow(void* a, i64 increment, i64 elemSize);
+void* __arrayInternalInitArena(Arena* arena, i64 capacity, i64 elemSize);
+
+//----------------------------------------------------------------------------------------------------------------------
+// Allocation profiling
+//
+// Define K_MEMORY_PROFILE to YES to record statistics for every call site that allocates memory through the K_ALLOC
+// macros.  Sites are stored in a lock-free table of K_MEMORY_PROFILE_SITES entries, and each block gets a small header
+// recording the site that allocated it so that frees are attributed to the allocating site.  Reallocations are
+// attributed to the site that called K_REALLOC.
+//
+// Without profiling, snapshots are empty and the dumps output nothing.
+//----------------------------------------------------------------------------------------------------------------------
+
+typedef struct
+{
+    const char* file;
+    int         line;
+    i64         allocs;         // Number of new blocks allocated at this site.
+    i64         reallocs;       // Number of blocks reallocated at this site.
+    i64         frees;          // Number of blocks allocated at this site that have been freed.
+    i64         liveBytes;      // Bytes currently allocated by this site.
+    i64         peakBytes;      // Highest value of liveBytes.
+    i64         totalBytes;     // Total bytes ever allocated by this site.
+    i64         churnBytes;     // Total bytes of old blocks that were reallocated at this site.
+}
+MemorySite;
+
+// Copy the current statistics of all call sites into a new array, sorted by peak bytes.  Destroy with arrayDone.
+Array(MemorySite) memoryProfileSnapshot();
+
+// Write a snapshot as a text table.
+void memoryProfileDump(FILE* f);
+
+// Write a snapshot as a JSON array of objects.
+void memoryProfileDumpJson(FILE* f);
 
 //----------------------------------------------------------------------------------------------------------------------
 // Pools
@@ -313,10 +594,10 @@ void* __arrayInternalGrow(void* a, i64 increment, i64 elemSize);
 #define Pool(T) T*
 
 // Destroy a pool
-#define poolDone(p) arrayDone(p)
+#define poolDone(p) (__poolInternalDone((p), sizeof(*(p))), (p) = 0)
 
 // Allocate an element from the pool - return address
-#define poolAcquire(p) __poolInternalAcquire((p), (p) ? __poolCapacity(p) : 1, sizeof(*(p)), &(p))
+#define poolAcquire(p) __poolInternalAcquire((p), (p) ? __poolCapacity(p) : 1, sizeof(*(p)), (void **)&(p))
 
 // Release an element back to the pool
 #define poolRecycle(p, i) __poolInternalRecycle((p), (i), sizeof(*(p)))
@@ -324,8 +605,8 @@ void* __arrayInternalGrow(void* a, i64 increment, i64 elemSize);
 // Index of an element
 #define poolIndexOf(p, e) ((i64)((u8 *)(e) - (u8 *)(p)) / sizeof(*(p)))
 
-// Enumerate a pool whose first field is an i64.
-#define poolFor(p) for (int i = 0; i < arrayCount(p); ++i) if (*(i64 *)&p[i] == -1)
+// Enumerate the indices of the acquired elements of a pool.  Use: poolFor(p) { T* e = &p[i]; ... }
+#define poolFor(p) for (i64 i = __poolInternalNext((p), sizeof(*(p)), 0); i >= 0; i = __poolInternalNext((p), sizeof(*(p)), i + 1))
 
 //
 // Internal routines
@@ -337,613 +618,4764 @@ void* __arrayInternalGrow(void* a, i64 increment, i64 elemSize);
 
 void* __poolInternalAcquire(void* p, i64 increment, i64 elemSize, void** outP);
 void __poolInternalRecycle(void* p, i64 index, i64 elemSize);
+void __poolInternalDone(void* p, i64 elemSize);
+i64 __poolInternalNext(void* p, i64 elemSize, i64 index);
 
 //----------------------------------------------------------------------------------------------------------------------
-//----------------------------------------------------------------------------------------------------------------------
-// Timer functions
-//----------------------------------------------------------------------------------------------------------------------
-//----------------------------------------------------------------------------------------------------------------------
-
-#if K_OS_WIN32
-#   define TimePoint LARGE_INTEGER
-#   define TimePeriod LARGE_INTEGER
-#else
-#   error Define Time for your platform!
+// Handle pools
+//
+// A HandlePool allocates fixed-size elements from chunks of K_HANDLE_POOL_CHUNK elements.  Chunks are never moved or
+// freed until the pool is destroyed, so the address of an element never changes.  Elements are referred to by 32-bit
+// handles that combine the slot index with a generation that changes every time the slot is recycled, so a stale handle
+// is detected in O(1).  Handles never have the top bit set, so they can be stored in an int, and 0 is never a valid
+// handle.
+
+#ifndef K_HANDLE_POOL_CHUNK
+#   define K_HANDLE_POOL_CHUNK 256     // Must be a power of 2 and at least 64.
 #endif
 
-// Return a time point representing
-TimePoint timeNow();
+#define K_HANDLE_INDEX_BITS 20
+#define K_HANDLE_GEN_BITS 11
 
-// Return a time period representing the time between time points.
-TimePeriod timePeriod(TimePoint a, TimePoint b);
+typedef u32 Handle;
 
-// Return a time representing an addition of two time periods.
-TimePeriod timeAdd(TimePeriod a, TimePeriod b);
+typedef struct
+{
+    Array(u8*)  chunks;
+    i64         elemSize;
+    i64         count;          // Number of slots that have ever been used.
+    i64         live;           // Number of acquired elements.
+    i64         freeList;       // Index of the first recycled slot, or -1.
+}
+HandlePool;
 
-// Advance a time point by a time period.
-TimePoint timeFuture(TimePoint t, TimePeriod p);
+// Create a pool of elements of elemSize bytes.  No memory is allocated until the first acquire.
+void handlePoolInit(HandlePool* pool, i64 elemSize);
 
-// Convert a time in secs to a time period.
-TimePeriod timeSecs(f64 time);
+// Destroy the pool and all its elements.
+void handlePoolDone(HandlePool* pool);
 
-// Convert a time in msecs to a time period.
-TimePeriod timeMsecs(i64 ms);
+// Allocate an uninitialised element and return its address and handle.  Returns 0 if the pool is full.
+void* handlePoolAcquire(HandlePool* pool, Handle* outHandle);
 
-// Convert a time period into an integer millisecond count.
-i64 timeToMSecs(TimePeriod period);
+// Release an element.  Stale handles are ignored.
+void handlePoolRecycle(HandlePool* pool, Handle handle);
 
-// Convert a time period into seconds
-f64 timeToSecs(TimePeriod period);
+// Return the address of an element, or 0 if the handle is stale or invalid.
+void* handlePoolGet(HandlePool* pool, Handle handle);
 
-// Block for a time period
-void timeWaitFor(TimePeriod time);
+// Return the slot of the element at an address, or -1 if it isn't in the pool.
+i64 handlePoolIndexOf(HandlePool* pool, const void* elem);
 
-// Block until a time point
-void timeWaitUntil(TimePoint time);
+// Return the handle of the live element in a slot.
+Handle handlePoolHandleAt(HandlePool* pool, i64 index);
 
-// Compare two periods and return -1, 0 or +1 depending on whether a < b, a == b or a > b
-int timeCompare(TimePeriod a, TimePeriod b);
+// Return the address of the element in a slot, live or not.
+#define handlePoolAt(pool, index) ((pool)->chunks[(index) / K_HANDLE_POOL_CHUNK] + __handlePoolDataOffset + ((index) & (K_HANDLE_POOL_CHUNK - 1)) * (pool)->elemSize)
 
-//----------------------------------------------------------------------------------------------------------------------
-//----------------------------------------------------------------------------------------------------------------------
-// Basic files access
-//----------------------------------------------------------------------------------------------------------------------
-//----------------------------------------------------------------------------------------------------------------------
+// Loop through the slots of live elements.  Use: handlePoolFor(pool) { T* e = (T *)handlePoolAt(pool, i); ... }
+#define handlePoolFor(pool) for (i64 i = __handlePoolNext((pool), 0); i >= 0; i = __handlePoolNext((pool), i + 1))
+
+//
+// Internal routines
+//
 
+// Each chunk starts with an occupancy bitmap, the free list links and the generations of its slots.  The generation
+// has K_HANDLE_LIVE set while the slot is acquired.
 typedef struct
 {
-    u8*     bytes;
-    i64     size;
+    u64     occupied[K_HANDLE_POOL_CHUNK / 64];
+    u32     next[K_HANDLE_POOL_CHUNK];
+    u16     gens[K_HANDLE_POOL_CHUNK];
+}
+HandlePoolChunk;
 
-#if K_OS_WIN32
-    HANDLE  file;
-    HANDLE  fileMap;
-#endif
-} Data;
+#define K_HANDLE_LIVE 0x8000
+#define __handlePoolDataOffset ((sizeof(HandlePoolChunk) + 63) & ~(size_t)63)
+#define __handlePoolChunk(pool, index) ((HandlePoolChunk *)(pool)->chunks[(index) / K_HANDLE_POOL_CHUNK])
 
-Data dataLoad(const char* fileName);
-Data dataMake(const char* fileName, i64 size);
-void dataUnload(Data data);
+i64 __handlePoolNext(HandlePool* pool, i64 index);
 
 //----------------------------------------------------------------------------------------------------------------------
-//----------------------------------------------------------------------------------------------------------------------
-// Strings
-//----------------------------------------------------------------------------------------------------------------------
-//----------------------------------------------------------------------------------------------------------------------
+// Concurrent pools
+//
+// A ConcurrentPool can be acquired from and recycled to by any number of threads without a lock.  Elements live in
+// chunks of K_CONCURRENT_POOL_CHUNK elements that never move and are referred to by index.  The shared free list is a
+// Treiber stack whose 64-bit head holds the top index and a tag that changes on every update, so a pop that races with
+// another thread popping and pushing back the same element fails its compare-and-swap instead of corrupting the list.
+//
+// Each thread keeps a magazine of up to K_POOL_MAGAZINE_SIZE free indices for up to K_POOL_MAGAZINE_COUNT pools, so most
+// acquires and recycles never touch the shared list.  A magazine is refilled or emptied half at a time.  Indices left
+// in a thread's magazine are lost to other threads until it calls concurrentPoolFlush, so call it before a thread
+// exits.  A thread that uses more pools than that at once works on the shared list directly for the pools that did
+// not get a magazine.
+
+#ifndef K_CONCURRENT_POOL_CHUNK
+#   define K_CONCURRENT_POOL_CHUNK 1024    // Must be a power of 2 and at least K_POOL_MAGAZINE_SIZE.
+#endif
 
-typedef i8* String;
+#ifndef K_CONCURRENT_POOL_MAX_CHUNKS
+#   define K_CONCURRENT_POOL_MAX_CHUNKS 4096
+#endif
 
-//----------------------------------------------------------------------------------------------------------------------
-// Hashing
-// Based on FNV-1a
-//----------------------------------------------------------------------------------------------------------------------
+#ifndef K_POOL_MAGAZINE_SIZE
+#   define K_POOL_MAGAZINE_SIZE 64
+#endif
 
-u64 hash(const u8* buffer, i64 len);
+#ifndef K_POOL_MAGAZINE_COUNT
+#   define K_POOL_MAGAZINE_COUNT 4
+#endif
 
-//----------------------------------------------------------------------------------------------------------------------
-// Dynamic strings
-//----------------------------------------------------------------------------------------------------------------------
+typedef struct
+{
+    volatile i64    head;           // (tag << 32) | (index + 1) of the top of the free list.  The index part is 0 if empty.
+    i64             padding[7];     // Keeps head and count on separate cache lines.
+    volatile i64    count;          // Number of slots that have been handed out to magazines.
+    u8**            chunks;         // Table of K_CONCURRENT_POOL_MAX_CHUNKS chunks, allocated as needed.
+    i64             elemSize;
+    i64             id;             // Identifies the pool in the thread magazines.
+}
+ConcurrentPool;
 
-// Create a string.
-String stringMake(const i8* str);
+// Create a pool of elements of elemSize bytes.
+void concurrentPoolInit(ConcurrentPool* pool, i64 elemSize);
 
-// Create a string of a set length.
-String stringReserve(i64 len);
+// Destroy the pool.  No other thread can be using it.
+void concurrentPoolDone(ConcurrentPool* pool);
 
-// Create a string of a set length.
-String stringReserveFill(i64 len, i8 ch);
+// Allocate an uninitialised element and return its address and index.  Returns 0 if the pool is full.
+void* concurrentPoolAcquire(ConcurrentPool* pool, i64* outIndex);
 
-// Unlock a string for writing.  Usually used after stringReserve is called.  Will assert if the length asked for
-// is greater than the string.
-char* stringLock(String str, i64 len);
+// Release an element.
+void concurrentPoolRecycle(ConcurrentPool* pool, i64 index);
 
-// Unlock the string so it can be used again.  Its internal has will be recomputed.
-void stringUnlock(String str);
+// Return this thread's cached indices to the shared free list.
+void concurrentPoolFlush(ConcurrentPool* pool);
 
-// Create a string from a byte range determined by a start and finish.
-String stringMakeRange(const i8* start, const i8* end);
+// Return the address of an element.
+#define concurrentPoolAt(pool, index) \
+    ((pool)->chunks[(index) / K_CONCURRENT_POOL_CHUNK] + __concurrentPoolDataOffset + \
+    ((index) & (K_CONCURRENT_POOL_CHUNK - 1)) * (pool)->elemSize)
 
-// Release a string back to memory.  It will also null the string variable.
-void stringDone(String* str);
+//
+// Internal routines
+//
 
-// Create a new string by appending it to another.
-String stringAppend(String str1, String str2);
-String stringAppendCStr(String str1, const i8* str2);
+// Each chunk starts with the free list links of its elements, as index + 1 of the next element.
+#define __concurrentPoolDataOffset (((sizeof(u32) * K_CONCURRENT_POOL_CHUNK) + 63) & ~(size_t)63)
 
-// Attributes of the string
-i64 stringLength(String str);
-u64 stringHash(String str);
+//----------------------------------------------------------------------------------------------------------------------
+// Queues
+//
+// A Queue(T) is a ring buffer with a power-of-2 capacity.  Pushing and popping at either end is O(1).  Like arrays, a
+// null pointer is an empty queue, but the elements do not start at index 0, so use queueAt to index them.
 
-// String formatting
-String stringFormat(const i8* format, ...);
-String stringFormatV(const i8* format, va_list args);
+#define Queue(T) T*
 
-// String comparison
-int stringCompare(String s1, const i8* s2);
+// Destroy a queue.
+#define queueDone(q) ((q) = ((q) ? K_FREE(__queueRaw(q), (sizeof(*(q)) * __queueCapacity(q)) + (sizeof(i64) * 4)), (void *)0 : (void *)0))
 
-// String comparison based on hashes.
-bool stringEqual(String s1, String s2);
+// Return the number of elements in a queue.
+#define queueCount(q) ((q) ? __queueCount(q) : 0)
 
-// Grow a string by appending in place.  The functions will return a new string, the old one will be destroyed.
-String stringGrow(String str1, String str2);
-String stringGrowCStr(String str1, const i8* str2);
-String stringGrowChar(String str, i8 ch);
+// Access the ith element from the front of the queue.
+#define queueAt(q, i) (q)[__queueIndex((q), (i))]
 
-//----------------------------------------------------------------------------------------------------------------------
-// Arena static strings
-// These are strings that are allocated on an arena and are just used for construction.  No operations are intended
-// to be run on them after creation.
-//----------------------------------------------------------------------------------------------------------------------
+// Access the front and back elements.  The queue must not be empty.
+#define queueFront(q) queueAt((q), 0)
+#define queueBack(q) queueAt((q), __queueCount(q) - 1)
 
-// Constructs a static string on the arena.
-String arenaStringCopy(Arena* arena, const i8* str);
+// Add an element to the back of the queue and return the value.
+#define queuePushBack(q, v) (__queueMayGrow(q), (q)[__queueIndex((q), __queueCount(q)++)] = (v))
 
-// Constructs a static string on the arena with a range.
-String arenaStringCopyRange(Arena* arena, const i8* str, const i8* end);
+// Add an element to the front of the queue and return the value.
+#define queuePushFront(q, v) (__queueMayGrow(q), __queueHead(q) = __queueIndex((q), -1), ++__queueCount(q), (q)[__queueHead(q)] = (v))
 
-// Create a formatted string on the arena with va_list args.
-String arenaStringFormatV(Arena* arena, const i8* format, va_list args);
+// Remove the front element from the queue and return it.  The queue must not be empty.
+#define queuePopFront(q) (--__queueCount(q), __queueHead(q) = __queueIndex((q), 1), (q)[__queueIndex((q), -1)])
 
-// Create formatted string on the arena with variable arguments.
-String arenaStringFormat(Arena* arena, const i8* format, ...);
+// Remove the back element from the queue and return it.  The queue must not be empty.
+#define queuePopBack(q) (--__queueCount(q), (q)[__queueIndex((q), __queueCount(q))])
+
+// Remove up to n elements from the front of the queue into the buffer dst, and return the number removed.
+#define queueDrain(q, dst, n) ((q) ? __queueInternalDrain((q), (dst), (n), sizeof(*(q))) : 0)
+
+// Remove all the elements.
+#define queueClear(q) ((q) ? (__queueHead(q) = 0, __queueCount(q) = 0) : 0)
+
+//
+// Internal routines
+//
+
+#define __queueRaw(q) ((i64 *)(q) - 4)
+#define __queueCapacity(q) __queueRaw(q)[0]
+#define __queueHead(q) __queueRaw(q)[1]
+#define __queueCount(q) __queueRaw(q)[2]
+#define __queueIndex(q, i) ((__queueHead(q) + (i)) & (__queueCapacity(q) - 1))
+
+#define __queueMayGrow(q) (((q) == 0 || __queueCount(q) == __queueCapacity(q)) ? ((q) = __queueInternalGrow((q), sizeof(*(q)))) : 0)
+
+void* __queueInternalGrow(void* q, i64 elemSize);
+i64 __queueInternalDrain(void* q, void* dst, i64 n, i64 elemSize);
 
 //----------------------------------------------------------------------------------------------------------------------
-// String tables
+// Hash maps
 //
-// The string table comprises of a header, a hash table, and an area for string storage.
+// A HashMap(K, V) is a pointer to its entries, which have a key and a value field, with a header stored before them
+// like arrays.  A null pointer is an empty map.  Keys are hashed and compared byte-wise, so they must not contain
+// uninitialised padding.
 //
-// The header comprises of a single i64 which is the size of the hash table.
+// Slots are found by linear probing, with 16 control bytes (7 bits of the hash or an empty marker) checked at a time
+// using SSE2.  Deleting shifts the entries that follow back into the hole, so there are no tombstones and lookups never
+// slow down after many deletes.  The map grows when it is 7/8 full.
 //
-// Next the hash table is an array of N pointers to the beginning of a linked list.  THe index of the hash table is
-// generated by the mod of the string's hash and the size of the table.
+// The key is staged in a spare entry after the table so that keys can be passed as values.  This means that even
+// lookups write to the map, so it must not be shared between threads without a lock.
 //
-// The string storage is just string information appended one after the other.  For each string you have this info:
+//      HashMap(u64, int) m = 0;
+//      hashMapPut(m, 42, 1);
+//      int* v = hashMapGet(m, 42);
+//      hashMapFor(m) { printf("%llu = %d\n", m[i].key, m[i].value); }
+//      hashMapDone(m);
 //
-// Offset   Size    Description
-//  0       8       Link to next string with the same hash index, indexed from beginning of string table
-//  8       8       64-bit hash of string (not including null terminator)
-//  16      ?       Actual string followed by a null terminator.
+// Each use of HashMap(K, V) declares a new anonymous struct, so two maps declared that way have different types.  To
+// pass a map to a function or assign one map to another, declare a named type once with HashMapType:
 //
-// Each string block is aligned in memory.  No string is allowed to have a hash of zero.  A string token of 0 is
-// always a null string.
-//----------------------------------------------------------------------------------------------------------------------
+//      HashMapType(IdMap, u64, int);       // Declares IdMapEntry and IdMap.
+//      void addIds(IdMap* m);
 
-typedef Arena StringTable;
-typedef i64 StringToken;
+typedef u64 (*HashFunc)(const void* key, i64 size);
 
-// Initialise a new string table
-void stringTableInit(StringTable* table, i64 size, i64 sizeHashTableSize);
+#define HashMap(K, V) struct { K key; V value; }*
 
-// Destroy the string table
-void stringTableDone(StringTable* table);
+// Declare Name as a map type from K to V, and Name##Entry as its entry type.
+#define HashMapType(Name, K, V) typedef struct { K key; V value; } Name##Entry; typedef Name##Entry* Name
 
-// Add a string to the table and return a unique token representing it.  If it already exists, its token will be
-// returned.
-StringToken stringTableAdd(StringTable* table, const i8* str);
+// Create an empty map that uses a custom hash function (otherwise hash() is used).
+#define hashMapInit(m, hashFunc) ((m) = __hashMapInternalReserve(0, 0, sizeof(*(m)), sizeof((m)->key), (hashFunc)))
 
-// Add a string view to the table.
-StringToken stringTableAddRange(StringTable* table, const i8* str, const i8* end);
+// Destroy a map.
+#define hashMapDone(m) ((m) = ((m) ? __hashMapInternalDone(m), (void *)0 : (void *)0))
 
-// Convert the token into a string in O(1) time.
-String stringTableGet(StringTable* table, StringToken token);
+// Return the number of entries in a map.
+#define hashMapCount(m) ((m) ? __hashMapRaw(m)->count : 0)
 
-//----------------------------------------------------------------------------------------------------------------------
-// Path strings
-//
-// Given the path "c:\dir1\dir2\file.foo.ext"
-//
-//  Path        "c:\dir1\dir2\file.foo.ext"
-//  Directory   "c:\dir1\dir2"
-//  Filename    "file.foo.ext"
-//  Extension   "ext"
-//  Base        "file.foo"
-//
-//----------------------------------------------------------------------------------------------------------------------
+// Return the number of slots in a map.  Used with hashMapFor.
+#define hashMapCapacity(m) ((m) ? __hashMapRaw(m)->capacity : 0)
 
-// Return the directory of a path
-String pathDirectory(const String path);
+// Make sure a map can hold n entries without growing.
+#define hashMapReserve(m, n) ((m) = __hashMapInternalReserve((m), (n), sizeof(*(m)), sizeof((m)->key), 0))
 
-// Return a new string with the extension removed
-String pathRemoveExtension(const String path);
+// Add or replace the value for a key and return the value.
+#define hashMapPut(m, k, v) (__hashMapMayGrow(m), __hashMapStage(m) = (k), (m)[__hashMapInternalInsert(m)].value = (v))
 
-// Return a new string with the extension of the path changed to a new one.
-String pathReplaceExtension(const String path, const char* ext);
+// Return the address of the value for a key, or 0 if it isn't in the map.
+#define hashMapGet(m, k) (((m) && (__hashMapStage(m) = (k), __hashMapInternalFind(m) >= 0)) ? &(m)[__hashMapRaw(m)->last].value : 0)
 
-// Join two paths together, the second must be a relative path.
-String pathJoin(const String p1, const String p2);
+// Return YES if the key is in the map.
+#define hashMapHas(m, k) (hashMapGet((m), (k)) != 0)
 
-// Return the path of the executable.
-String pathExe();
+// Remove a key from the map.  Returns YES if it was found.
+#define hashMapDelete(m, k) ((m) ? (__hashMapStage(m) = (k), __hashMapInternalDelete(m)) : NO)
 
-//----------------------------------------------------------------------------------------------------------------------
-// String utilities
-//
-// stringCompareStringRange     Compare s1..s2 with null terminated s3.
-//----------------------------------------------------------------------------------------------------------------------
+// Remove all the entries from a map but keep the memory.
+#define hashMapClear(m) ((m) ? __hashMapInternalClear(m) : (void)0)
 
-int stringCompareStringRange(const i8* s1, const i8* s2, const i8* s3);
+// Loop through the entries of a map.  Use: hashMapFor(m) { m[i].key ... m[i].value }
+#define hashMapFor(m) for (i64 i = 0; i < hashMapCapacity(m); ++i) if (__hashMapCtrl(m)[i] & K_HASHMAP_EMPTY) {} else
 
-//----------------------------------------------------------------------------------------------------------------------
-//----------------------------------------------------------------------------------------------------------------------
-// Random number generation
-//----------------------------------------------------------------------------------------------------------------------
-//----------------------------------------------------------------------------------------------------------------------
+//
+// Internal routines
+//
 
-#define K_RANDOM_TABLE_SIZE     312
+#define K_HASHMAP_EMPTY 0x80
+#define K_HASHMAP_GROUP 16
 
 typedef struct
 {
-    u64     table[K_RANDOM_TABLE_SIZE];
-    u64     index;
+    i64         capacity;       // Number of slots (a power of 2).
+    i64         count;
+    i64         last;           // Index of the slot found by the last lookup.
+    i64         entrySize;
+    i64         keySize;
+    HashFunc    hashFunc;
+    i64         reserved[2];
 }
-Random;
+HashMapHeader;
 
-// Initialise based on time.
-void randomInit(Random* R);
+// Memory layout: header, capacity entries, staging entry, capacity + K_HASHMAP_GROUP control bytes.  The control bytes
+// for the first group are repeated at the end so that a group can be loaded from any slot without wrapping.
+#define __hashMapRaw(m) ((HashMapHeader *)(m) - 1)
+#define __hashMapStage(m) (m)[__hashMapRaw(m)->capacity].key
+#define __hashMapCtrl(m) ((u8 *)(m) + (__hashMapRaw(m)->capacity + 1) * __hashMapRaw(m)->entrySize)
+#define __hashMapMayGrow(m) (((m) == 0 || (__hashMapRaw(m)->count + 1) * 8 > __hashMapRaw(m)->capacity * 7) ? hashMapReserve((m), hashMapCount(m) + 1) : 0)
 
-// Initialise with a single seed value.
-void randomInitSeed(Random* R, u64 seed);
+void* __hashMapInternalReserve(void* m, i64 n, i64 entrySize, i64 keySize, HashFunc hashFunc);
+void __hashMapInternalDone(void* m);
+i64 __hashMapInternalInsert(void* m);
+i64 __hashMapInternalFind(void* m);
+bool __hashMapInternalDelete(void* m);
+void __hashMapInternalClear(void* m);
 
-// Initialise with an array of seeds.
-void randomInitArray(Random* R, u64* seeds, i64 len);
+//----------------------------------------------------------------------------------------------------------------------
+// Sorting
+//
+// arraySort is an in-place introsort (quicksort that falls back to heapsort on bad pivots, and insertion sort for
+// small ranges).  It is not stable.
+//
+// arrayRadixSort is a stable LSD radix sort on 64-bit keys with 11-bit digits.  Passes where every key has the same
+// digit are skipped, so small keys cost fewer passes.  The key function turns an element into an unsigned key that
+// sorts in the same order.  If it is 0, the elements must be unsigned integers of 1, 2, 4 or 8 bytes.  Use the
+// radixKeyXXX functions for signed and floating-point elements.  It needs temporary memory of n * (16 + element size).
+//
+// arraySortParallel sorts pieces of the array on up to K_SORT_MAX_THREADS threads and merges them, also in parallel.
+// Arrays smaller than K_SORT_PARALLEL_MIN elements are just sorted with arraySort.  Like arraySort, it is not stable.
+// It needs temporary memory of n * element size.
 
-// Return a 64-bit pseudo-random number.
-u64 random64(Random* R);
+#ifndef K_SORT_MAX_THREADS
+#   define K_SORT_MAX_THREADS  8
+#endif
 
-// Return a random float inclusive [0, 1].
-f64 randomFloat(Random* R);
+#ifndef K_SORT_PARALLEL_MIN
+#   define K_SORT_PARALLEL_MIN 65536
+#endif
 
-// Return a random float exclusive [0, 1).
-f64 randomFloatNo1(Random* R);
+// Same as the comparator for qsort.
+typedef int (*SortCompareFunc)(const void* a, const void* b);
 
-// Return a random float really exclusive (0, 1).
-f64 randomFloatNo0Or1(Random* R);
+// Returns a key for an element.  Keys are sorted in unsigned order.
+typedef u64 (*RadixKeyFunc)(const void* elem);
 
-//----------------------------------------------------------------------------------------------------------------------
-//----------------------------------------------------------------------------------------------------------------------
-// CRC-32 API
-//----------------------------------------------------------------------------------------------------------------------
-//----------------------------------------------------------------------------------------------------------------------
+#define arraySort(a, cmp) sortInPlace((a), arrayCount(a), sizeof(*(a)), (cmp))
+#define arrayRadixSort(a, key) sortRadix((a), arrayCount(a), sizeof(*(a)), (key))
+#define arraySortParallel(a, cmp) sortParallel((a), arrayCount(a), sizeof(*(a)), (cmp))
 
-// Checksum calculation
-u32 crc32(void* data, i64 len);
-u32 crc32Update(u32 crc, void* data, i64 len);
+void sortInPlace(void* base, i64 count, i64 elemSize, SortCompareFunc cmp);
+void sortRadix(void* base, i64 count, i64 elemSize, RadixKeyFunc key);
+void sortParallel(void* base, i64 count, i64 elemSize, SortCompareFunc cmp);
+
+// Radix keys for signed and floating-point elements.
+u64 radixKeyI32(const void* elem);
+u64 radixKeyI64(const void* elem);
+u64 radixKeyF32(const void* elem);
+u64 radixKeyF64(const void* elem);
 
 //----------------------------------------------------------------------------------------------------------------------
 //----------------------------------------------------------------------------------------------------------------------
-// SHA-1 API
+// Timer functions
+//
+// Time points and periods are counted in ticks of a monotonic clock whose frequency is measured once by timeInit.
+// Windows uses QueryPerformanceCounter and POSIX uses clock_gettime(CLOCK_MONOTONIC).  If K_TIME_TSC is YES and the
+// CPU has an invariant TSC, the clock reads the TSC with rdtsc instead, which costs a few nanoseconds rather than a call
+// into the OS.  Its frequency is calibrated against the OS clock over K_TIME_TSC_CALIBRATION milliseconds.
+//
+// timeWaitUntil sleeps until shortly before the deadline and spins for the rest.  How long it spins is tuned from how
+// far the thread's recent sleeps overran their request, weighted towards the last K_TIME_WAIT_HISTORY sleeps, so waits
+// are accurate to a few microseconds without burning a core.
 //----------------------------------------------------------------------------------------------------------------------
 //----------------------------------------------------------------------------------------------------------------------
 
+#ifndef K_TIME_TSC
+#   define K_TIME_TSC NO
+#endif
+
+#ifndef K_TIME_TSC_CALIBRATION
+#   define K_TIME_TSC_CALIBRATION 10
+#endif
+
+#ifndef K_TIME_WAIT_SPIN_US
+#   define K_TIME_WAIT_SPIN_US 2000     // Initial spin time before the oversleep has been measured.
+#endif
+
+#ifndef K_TIME_WAIT_HISTORY
+#   define K_TIME_WAIT_HISTORY 32
+#endif
+
+#if K_OS_WIN32
+#   define TimePoint LARGE_INTEGER
+#   define TimePeriod LARGE_INTEGER
+#else
+// Matches LARGE_INTEGER so that code using time points is the same on all platforms.
 typedef struct
 {
-    u32     state[5];
-    u32     count[2];
-    u8      digest[20];
-    u8      buffer[64];
-    bool    finalised;
+    i64     QuadPart;
 }
-Sha1;
+TimeTicks;
 
-//
-// Initialisation
-//
-void sha1Init(Sha1* s);
+#   define TimePoint TimeTicks
+#   define TimePeriod TimeTicks
+#endif
 
-// The process functions will initialise, process and finalise in one step.
-void sha1ProcessBuffer(Sha1* s, const void* data, i64 numBytes);
-void sha1ProcessString(Sha1* s, String str);
-void sha1ProcessHexString(Sha1* s, String hexStr);
-void sha1ProcessData(Sha1* s, Data data);
+// Choose the clock and measure its frequency.  This is done by the entry point, or by the first time function called.
+void timeInit();
 
-//
-// Updating & finalisation
-//
-void sha1Add(Sha1* s, const void* data, i64 numBytes);
-void sha1Finalise(Sha1* s);
+// Return the number of clock ticks per second.
+i64 timeFrequency();
 
-//
-// Conversion
-//
-String sha1Hex(Sha1* s);
-u64 sha1Hash64(Sha1* s);
+// Return a time point representing now.
+TimePoint timeNow();
 
-//
-// Testing
-//
-bool sha1Equal(Sha1* s1, Sha1* s2);
+// Return a time period representing the time between time points.
+TimePeriod timePeriod(TimePoint a, TimePoint b);
 
-//----------------------------------------------------------------------------------------------------------------------
-//----------------------------------------------------------------------------------------------------------------------
-// Process spawning API
-//----------------------------------------------------------------------------------------------------------------------
-//----------------------------------------------------------------------------------------------------------------------
+// Return a time representing an addition of two time periods.
+TimePeriod timeAdd(TimePeriod a, TimePeriod b);
 
-// Start a process
-bool processStartAndWait(const i8* fileName, int argc, const i8** argv);
+// Advance a time point by a time period.
+TimePoint timeFuture(TimePoint t, TimePeriod p);
 
-//----------------------------------------------------------------------------------------------------------------------
-//----------------------------------------------------------------------------------------------------------------------
-// PNG writing
-//----------------------------------------------------------------------------------------------------------------------
-//----------------------------------------------------------------------------------------------------------------------
+// Convert a time in secs to a time period.
+TimePeriod timeSecs(f64 time);
 
-bool pngWrite(const char* fileName, u32* img, int width, int height);
+// Convert a time in msecs to a time period.
+TimePeriod timeMsecs(i64 ms);
 
-//----------------------------------------------------------------------------------------------------------------------
-//----------------------------------------------------------------------------------------------------------------------
-// Regular Expressions
-//----------------------------------------------------------------------------------------------------------------------
-// Inspired by Rob Pike's simple regex code and Kokke's code at https://github.com/kokke/tiny-regex-c
-//----------------------------------------------------------------------------------------------------------------------
+// Convert a time period into an integer millisecond count.
+i64 timeToMSecs(TimePeriod period);
 
-#define K_NO_MATCH -1
+// Convert a time period into seconds
+f64 timeToSecs(TimePeriod period);
 
-// This function is very BASIC.  Matches using these symbols:
-//
-//      .           matches any single character
-//      ^           matches beginning of input string
-//      $           matches end of input string
-//      *           matches zero or more occurrences of the previous character (greedy)
-//      +           matches one or more (greedy)
-//      ?           matches zero or one (non-greedy)
-//      [abc]       matches one of a, b, or c
-//      [^abc]      matches anything but a, b or c (broken)
-//      [a-zA-z]    matches character ranges
-//      \s          whitespace (\t, \f, \r, \n, \v, spaces)
-//      \S          non-whitespace
-//      \w          C-based Alphanumeric [a-zA-Z0-9_]
-//      \W          Non c-based alphanumeric
-//      \d          Digits, [0-9]
-//      \D          Non-digits
-//      \x          Hexadecimal digits, [0-9a-fA-F]
-//      \X          Non-hexadecimal digits
-//
-// Returns the position where the match was found or K_NO_MATCH if not match was found.
-int match(const i8 *regexp, const i8* text);
+// Block for a time period
+void timeWaitFor(TimePeriod time);
 
-// Pre-compiled version of a regular expression
-typedef struct RegEx RegEx;
+// Block until a time point
+void timeWaitUntil(TimePoint time);
 
-// Generate a pre-compiled version of the regular expression
-RegEx regexCompile(const i8* pattern);
+// Compare two periods and return -1, 0 or +1 depending on whether a < b, a == b or a > b
+int timeCompare(TimePeriod a, TimePeriod b);
 
-// Release the resources used my compiling the regular expression.
-void regexRelease(RegEx re);
+typedef struct
+{
+    i64     waits;              // Number of waits that had to block.
+    i64     sleeps;             // Number of times the OS was asked to sleep.
+    f64     oversleep;          // Running mean of how far sleeps overran, in seconds.
+    f64     oversleepDev;       // Running mean deviation of the oversleep, in seconds.
+    f64     spinTime;           // How long before a deadline waits stop sleeping and start spinning, in seconds.
+    f64     lateMean;           // Mean time waits returned after their deadline, in seconds.
+    f64     lateMax;            // Longest time a wait returned after its deadline, in seconds.
+}
+TimeWaitStats;
 
-// Use a pre-compiled version of a regular expression for matching
-int regexMatch(RegEx regex, const i8* text);
+// Return the statistics of timeWaitUntil for this thread.
+TimeWaitStats timeWaitStats();
 
 //----------------------------------------------------------------------------------------------------------------------
 //----------------------------------------------------------------------------------------------------------------------
-// Geometry
+// Timer wheels
+//
+// A TimerWheel schedules callbacks for many deadlines at once.  Time is divided into ticks of a fixed resolution and
+// timers are kept in K_TIMER_WHEEL_LEVELS wheels of K_TIMER_WHEEL_SLOTS slots, each level covering K_TIMER_WHEEL_SLOTS
+// times the range of the one below.  Adding and cancelling a timer is O(1).  Advancing the wheel is amortised O(1) per
+// tick: when the lowest wheel wraps, the next slot of the level above is cascaded down.  Timers never fire early, but
+// may fire up to one tick late.  Timers further away than the range of the wheel are parked in the top level and
+// cascaded again until they are in range.
+//
+// Timers are referred to by handles, so cancelling a timer that has already fired does nothing.  Callbacks can add and
+// cancel timers, including their own.
 //----------------------------------------------------------------------------------------------------------------------
 //----------------------------------------------------------------------------------------------------------------------
 
-typedef struct _Point
-{
-    int x;
-    int y;
-}
-Point, *PointRef;
+#define K_TIMER_WHEEL_BITS      6
+#define K_TIMER_WHEEL_SLOTS     (1 << K_TIMER_WHEEL_BITS)
+#define K_TIMER_WHEEL_LEVELS    4
 
-typedef struct _Size
+typedef void(*TimerFunc) (Handle timer, void* data);
+
+typedef struct TimerNode
 {
-    int w;
-    int h;
+    struct TimerNode*   next;
+    struct TimerNode*   prev;
+    struct TimerNode**  list;       // Slot this timer is in, or 0 while it is firing.
+    i64                 expiry;     // Tick to fire on.
+    i64                 interval;   // Ticks between repeats, or 0 for a one-shot timer.
+    TimerFunc           func;
+    void*               data;
+    Handle              handle;
 }
-Size, *SizeRef;
+TimerNode;
 
-typedef struct _Rect
+typedef struct
 {
-    int x, y;
-    int w, h;
+    HandlePool  timers;
+    TimerNode*  slots[K_TIMER_WHEEL_LEVELS][K_TIMER_WHEEL_SLOTS];
+    TimePoint   start;
+    TimePeriod  resolution;
+    i64         tick;               // Ticks since start that have been processed.
 }
-Rect, *RectRef;
+TimerWheel;
 
-Point pointMake(int x, int y);
-Size sizeMake(int w, int h);
-Rect rectMake(int x, int y, int w, int h);
+// Create a timer wheel whose ticks are resolution long, starting now.
+void timerWheelInit(TimerWheel* wheel, TimePeriod resolution);
 
-Rect rectUnion(Rect a, Rect b);
-Rect rectIntersect(Rect a, Rect b);
+// Destroy a timer wheel and all its timers.
+void timerWheelDone(TimerWheel* wheel);
 
-void blit(
-    void* dst,              // The destination 2d array
-    Size dstSize,           // The destination 2d array size
-    const void* src,        // The source 2d array
-    Size srcSize,           // The source 2d array size
-    int dx, int dy,         // The coordinates in the destination 2d array to copy to.
-    int sx, int sy,         // The coordinates in the source 2d array to copy from
-    int w, int h,           // Dimensions of the rectangle that is copied (same for both source and destination).
-    int elemSize);          // Size of each element in the arrays
+// Call func after delay, and then every repeat if repeat is not zero.  Returns the timer's handle.
+Handle timerWheelAdd(TimerWheel* wheel, TimePeriod delay, TimePeriod repeat, TimerFunc func, void* data);
 
+// Stop a timer.  Returns NO if the timer has already fired or been cancelled.
+bool timerWheelCancel(TimerWheel* wheel, Handle timer);
 
+// Fire all the timers that are due by a time point.  Returns the number of timers fired.
+i64 timerWheelAdvance(TimerWheel* wheel, TimePoint now);
+
+// Return in outTime a time point before which no timer will fire, so that an event loop knows how long it can wait.
+// Returns NO if there are no timers.
+bool timerWheelNext(TimerWheel* wheel, TimePoint* outTime);
+
+// Return the number of pending timers.
+#define timerWheelCount(wheel) ((wheel)->timers.live)
 
 //----------------------------------------------------------------------------------------------------------------------
 //----------------------------------------------------------------------------------------------------------------------
-//----------------------------------------------------------------------------------------------------------------------
-//----------------------------------------------------------------------------------------------------------------------
-
-//----------------------------------------------------------------------------------------------------------------------{INDEX}
-// INDEX
+// Tracing
 //
-//  ARRAY       Array management
-//  CRC32       CRC-32 checksumming
-//  DATA        Data loading
-//  ENTRY       Entry point
-//  GEOMETRY    Geometry API
-//  HASH        Fast hashing
-//  MEMORY      Memory management
-//  PLATFORM    Platform-specific code
-//  PNG         Simple uncompressed PNG output (for debugging)
-//  POOL        Memory pools
-//  RANDOM      Random number generation
-//  REGEX       Regular expressions
-//  SHA1        SHA-1 checksumming
-//  SPAWN       Process spawning API
-//  STRING      String processing, arena strings, paths and string tables
-//  TIME        Time management
+// Trace zones show where time is spent.  K_TRACE_BEGIN and K_TRACE_END bracket a zone and K_TRACE_ZONE wraps a block in
+// one (don't leave the block with return, break or goto).  Zone names must be string literals.  Each thread records
+// its events into its own ring buffer of K_TRACE_EVENTS events, so recording takes no locks.  When a ring is full, the
+// oldest events are overwritten.  traceFlush writes the events as Chrome trace-event JSON, which can be loaded into
+// chrome://tracing or ui.perfetto.dev.  Threads can keep recording while another thread flushes, but only one thread
+// may flush at a time.  The end of a zone that was still open at a flush is written by the next flush.
 //
+// The macros compile to nothing unless K_TRACE is YES.
+//----------------------------------------------------------------------------------------------------------------------
 //----------------------------------------------------------------------------------------------------------------------
 
-#ifdef K_IMPLEMENTATION
+#ifndef K_TRACE
+#   define K_TRACE NO
+#endif
 
-#include <time.h>
+#ifndef K_TRACE_EVENTS
+#   define K_TRACE_EVENTS 65536     // Per thread.  Must be a power of 2.
+#endif
 
-#if K_OS_WIN32
-#   include <conio.h>
-#   include <fcntl.h>
-#   include <io.h>
+#ifndef K_TRACE_THREADS
+#   define K_TRACE_THREADS 64       // Threads beyond this are not traced.
 #endif
 
-//----------------------------------------------------------------------------------------------------------------------
+#if K_TRACE
+#   define K_TRACE_BEGIN(name) traceBegin(name)
+#   define K_TRACE_END() traceEnd()
+#   define K_TRACE_ZONE(name) for (int __traceZone = (traceBegin(name), 1); __traceZone; __traceZone = (traceEnd(), 0))
+#else
+#   define K_TRACE_BEGIN(name)
+#   define K_TRACE_END()
+#   define K_TRACE_ZONE(name)
+#endif
+
+// Record the start of a zone on this thread.
+void traceBegin(const char* name);
+
+// Record the end of the innermost zone on this thread.
+void traceEnd();
+
+// Write the events recorded on all threads since the last flush as a Chrome trace.  Returns the number of events
+// written.
+i64 traceFlush(FILE* f);
+
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+// Basic files access
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+
+typedef struct
+{
+    u8*     bytes;
+    i64     size;
+
+#if K_OS_WIN32
+    HANDLE  file;
+    HANDLE  fileMap;
+#else
+    int     file;
+    i64     capacity;       // Non-zero if the bytes were read into the heap because the file could not be mapped.
+#endif
+} Data;
+
+// Hints about how the bytes of a Data will be accessed.  They can be combined.
+//
+//  DH_Sequential   Read ahead further and drop pages behind the reader (MADV_SEQUENTIAL, FILE_FLAG_SEQUENTIAL_SCAN).
+//  DH_Random       Don't read ahead (MADV_RANDOM, FILE_FLAG_RANDOM_ACCESS).
+//  DH_WillNeed     Start reading the whole file in the background (MADV_WILLNEED, PrefetchVirtualMemory).
+//  DH_Populate     Read the whole file before returning, so there are no page faults later (MAP_POPULATE).
+//
+typedef enum
+{
+    DH_Normal       = 0,
+    DH_Sequential   = 1 << 0,
+    DH_Random       = 1 << 1,
+    DH_WillNeed     = 1 << 2,
+    DH_Populate     = 1 << 3,
+}
+DataHint;
+
+// Map a file into memory for reading.  If the file cannot be mapped (for example, files in /proc), it is read into the
+// heap instead.  On failure, bytes is 0.
+Data dataLoad(const char* fileName);
+Data dataLoadHint(const char* fileName, u32 hints);
+
+// Create a file of the given size and map it into memory for writing.
+Data dataMake(const char* fileName, i64 size);
+Data dataMakeHint(const char* fileName, i64 size, u32 hints);
+
+void dataUnload(Data data);
+
+//----------------------------------------------------------------------------------------------------------------------
+// Data writers
+//
+// A data writer creates a file whose final size isn't known and maps it, so output can be written straight into the
+// page cache with no staging copy.  When a write goes past the end of the mapping, the file is doubled in size and
+// remapped.  dataWriterClose truncates the file to the bytes actually written.
+//
+// Because growing can move the mapping, a pointer from dataWriterAlloc is only valid until the next call to
+// dataWriterAlloc or dataWriterWrite.
+//----------------------------------------------------------------------------------------------------------------------
+
+// The smallest mapping a writer starts with.
+#ifndef K_DATA_WRITER_MIN_SIZE
+#   define K_DATA_WRITER_MIN_SIZE  K_KB(64)
+#endif
+
+typedef struct
+{
+    u8*     bytes;          // The mapping of the file.
+    i64     size;           // Bytes written so far.
+    i64     capacity;       // Size of the file and the mapping.
+
+#if K_OS_WIN32
+    HANDLE  file;
+    HANDLE  fileMap;
+#else
+    int     file;
+#endif
+}
+DataWriter;
+
+// Create a file for writing.  initialSize is a guess at the final size.
+bool dataWriterOpen(DataWriter* w, const char* fileName, i64 initialSize);
+
+// Return the next numBytes bytes of the file to write to, growing it if necessary.  Returns 0 if it can't grow.
+u8* dataWriterAlloc(DataWriter* w, i64 numBytes);
+
+bool dataWriterWrite(DataWriter* w, const void* data, i64 numBytes);
+
+// Start writing the bytes so far back to the file (msync MS_ASYNC).  If wait is YES, returns once they are written.
+void dataWriterFlush(DataWriter* w, bool wait);
+
+// Unmap the file and truncate it to the bytes written.
+bool dataWriterClose(DataWriter* w);
+
+//----------------------------------------------------------------------------------------------------------------------
+// Data streams
+//
+// A data stream reads a file, pipe or standard input a chunk at a time into a fixed buffer, so inputs of any size can
+// be processed in constant memory.  Each call to dataStreamNext moves the window on to the next chunk.  The bytes are
+// read straight into the buffer, so the window is never copied.
+//
+// A consumer that can't finish with the end of a window (a token cut in half, say) passes the number of bytes it
+// didn't use to dataStreamNext as keep.  Those bytes are moved to just before the next chunk so that the next window
+// starts with them.  Up to overlap bytes can be kept.
+//
+//      DataStream ds;
+//      i64 keep = 0;
+//      if (dataStreamOpen(&ds, 0, K_MB(1), K_KB(4)))
+//      {
+//          while (dataStreamNext(&ds, keep))
+//          {
+//              keep = process(ds.bytes, ds.size, ds.eof);
+//          }
+//          dataStreamClose(&ds);
+//      }
+//
+//----------------------------------------------------------------------------------------------------------------------
+
+typedef struct
+{
+    u8*     bytes;          // The current window.
+    i64     size;
+    i64     offset;         // Offset of the window into the stream.
+    bool    eof;            // YES if this is the last window.
+    bool    error;          // YES if the stream ended because of a read error.
+
+    u8*     buffer;         // overlap bytes followed by chunkSize bytes.
+    i64     chunkSize;
+    i64     overlap;
+    bool    closeFile;
+#if K_OS_WIN32
+    HANDLE  file;
+#else
+    int     file;
+#endif
+}
+DataStream;
+
+// Open a file for streaming, or standard input if fileName is 0.
+bool dataStreamOpen(DataStream* ds, const char* fileName, i64 chunkSize, i64 overlap);
+
+// Read the next chunk, keeping the last keep bytes of the current window.  Returns NO when there is nothing left.
+bool dataStreamNext(DataStream* ds, i64 keep);
+
+void dataStreamClose(DataStream* ds);
+
+//----------------------------------------------------------------------------------------------------------------------
+// Asynchronous loading
+//
+// A DataLoader reads whole files into memory in the background, so that a process can keep many reads in flight while
+// it works on files that have already arrived.  On Linux, the reads are submitted in batches through io_uring straight
+// into heap buffers.  Elsewhere, or if the kernel doesn't support io_uring, K_DATA_LOADER_THREADS threads each map a
+// file with DH_Populate.
+//
+// dataLoadAsync returns a handle that completes into a Data.  dataWaitAny and dataWaitAll wait for handles to complete
+// and hand over their Data, which is then released with dataUnload as usual.  A handle is no longer valid once it has
+// been waited for.  A DataLoader must only be used from one thread.
+//
+//      Handle h[3] = { dataLoadAsync(&L, "a"), dataLoadAsync(&L, "b"), dataLoadAsync(&L, "c") };
+//      i64 count = 3;
+//      while (count > 0)
+//      {
+//          Data d;
+//          i64 i = dataWaitAny(&L, h, count, &d);
+//          process(d);
+//          dataUnload(d);
+//          h[i] = h[--count];
+//      }
+//
+//----------------------------------------------------------------------------------------------------------------------
+
+#ifndef K_DATA_LOADER_THREADS
+#   define K_DATA_LOADER_THREADS   4
+#endif
+
+// Maximum number of io_uring reads in flight.  More loads than this are queued until reads complete.
+#ifndef K_DATA_LOADER_DEPTH
+#   define K_DATA_LOADER_DEPTH     64
+#endif
+
+// io_uring reads are submitted once this many are queued, or when waiting.
+#ifndef K_DATA_LOADER_BATCH
+#   define K_DATA_LOADER_BATCH     8
+#endif
+
+#ifndef K_DATA_LOADER_URING
+#   define K_DATA_LOADER_URING     K_OS_LINUX
+#endif
+
+typedef struct
+{
+    HandlePool      requests;
+    bool            uring;          // YES if io_uring is used rather than threads.
+    void*           impl;
+}
+DataLoader;
+
+void dataLoaderInit(DataLoader* L);
+
+// Waits for all loads to finish and releases any Data that were never waited for.
+void dataLoaderDone(DataLoader* L);
+
+// Start loading a file.  Always returns a handle.  If the file can't be read, the handle completes with data->bytes set
+// to 0.
+Handle dataLoadAsync(DataLoader* L, const char* fileName);
+
+// Wait until one of the handles has completed, store its Data in data and return its index.  data->bytes is 0 if the
+// file could not be read.  Returns -1 if count is 0.
+i64 dataWaitAny(DataLoader* L, const Handle* handles, i64 count, Data* data);
+
+// Wait until all the handles have completed and store their Data in data[0..count-1].
+void dataWaitAll(DataLoader* L, const Handle* handles, i64 count, Data* data);
+
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+// Strings
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+
+typedef i8* String;
+
+//----------------------------------------------------------------------------------------------------------------------
+// Hashing
+// Based on FNV-1a
+//----------------------------------------------------------------------------------------------------------------------
+
+u64 hash(const u8* buffer, i64 len);
+
+//----------------------------------------------------------------------------------------------------------------------
+// Dynamic strings
+//----------------------------------------------------------------------------------------------------------------------
+
+// Create a string.
+String stringMake(const i8* str);
+
+// Create a string of a set length.
+String stringReserve(i64 len);
+
+// Create a string of a set length.
+String stringReserveFill(i64 len, i8 ch);
+
+// Unlock a string for writing.  Usually used after stringReserve is called.  Will assert if the length asked for
+// is greater than the string.
+char* stringLock(String str, i64 len);
+
+// Unlock the string so it can be used again.  Its internal has will be recomputed.
+void stringUnlock(String str);
+
+// Create a string from a byte range determined by a start and finish.
+String stringMakeRange(const i8* start, const i8* end);
+
+// Release a string back to memory.  It will also null the string variable.
+void stringDone(String* str);
+
+// Create a new string by appending it to another.
+String stringAppend(String str1, String str2);
+String stringAppendCStr(String str1, const i8* str2);
+
+// Attributes of the string
+i64 stringLength(String str);
+u64 stringHash(String str);
+
+// String formatting
+String stringFormat(const i8* format, ...);
+String stringFormatV(const i8* format, va_list args);
+
+// String comparison
+int stringCompare(String s1, const i8* s2);
+
+// String comparison based on hashes.
+bool stringEqual(String s1, String s2);
+
+// Grow a string by appending in place.  The functions will return a new string, the old one will be destroyed.
+String stringGrow(String str1, String str2);
+String stringGrowCStr(String str1, const i8* str2);
+String stringGrowChar(String str, i8 ch);
+
+//----------------------------------------------------------------------------------------------------------------------
+// Arena static strings
+// These are strings that are allocated on an arena and are just used for construction.  No operations are intended
+// to be run on them after creation.
+//----------------------------------------------------------------------------------------------------------------------
+
+// Constructs a static string on the arena.
+String arenaStringCopy(Arena* arena, const i8* str);
+
+// Constructs a static string on the arena with a range.
+String arenaStringCopyRange(Arena* arena, const i8* str, const i8* end);
+
+// Create a formatted string on the arena with va_list args.
+String arenaStringFormatV(Arena* arena, const i8* format, va_list args);
+
+// Create formatted string on the arena with variable arguments.
+String arenaStringFormat(Arena* arena, const i8* format, ...);
+
+//----------------------------------------------------------------------------------------------------------------------
+// String tables
+//
+// The string table comprises of a header, a hash table, and an area for string storage.
+//
+// The header comprises of a single i64 which is the size of the hash table.
+//
+// Next the hash table is an array of N pointers to the beginning of a linked list.  THe index of the hash table is
+// generated by the mod of the string's hash and the size of the table.
+//
+// The string storage is just string information appended one after the other.  For each string you have this info:
+//
+// Offset   Size    Description
+//  0       8       Link to next string with the same hash index, indexed from beginning of string table
+//  8       8       64-bit hash of string (not including null terminator)
+//  16      ?       Actual string followed by a null terminator.
+//
+// Each string block is aligned in memory.  No string is allowed to have a hash of zero.  A string token of 0 is
+// always a null string.
+//----------------------------------------------------------------------------------------------------------------------
+
+typedef Arena StringTable;
+typedef i64 StringToken;
+
+// Initialise a new string table
+void stringTableInit(StringTable* table, i64 size, i64 sizeHashTableSize);
+
+// Destroy the string table
+void stringTableDone(StringTable* table);
+
+// Add a string to the table and return a unique token representing it.  If it already exists, its token will be
+// returned.
+StringToken stringTableAdd(StringTable* table, const i8* str);
+
+// Add a string view to the table.
+StringToken stringTableAddRange(StringTable* table, const i8* str, const i8* end);
+
+// Convert the token into a string in O(1) time.
+String stringTableGet(StringTable* table, StringToken token);
+
+//----------------------------------------------------------------------------------------------------------------------
+// Path strings
+//
+// Given the path "c:\dir1\dir2\file.foo.ext"
+//
+//  Path        "c:\dir1\dir2\file.foo.ext"
+//  Directory   "c:\dir1\dir2"
+//  Filename    "file.foo.ext"
+//  Extension   "ext"
+//  Base        "file.foo"
+//
+//----------------------------------------------------------------------------------------------------------------------
+
+// Return the directory of a path
+String pathDirectory(const String path);
+
+// Return a new string with the extension removed
+String pathRemoveExtension(const String path);
+
+// Return a new string with the extension of the path changed to a new one.
+String pathReplaceExtension(const String path, const char* ext);
+
+// Join two paths together, the second must be a relative path.
+String pathJoin(const String p1, const String p2);
+
+// Return the path of the executable.
+String pathExe();
+
+//----------------------------------------------------------------------------------------------------------------------
+// String utilities
+//
+// stringCompareStringRange     Compare s1..s2 with null terminated s3.
+//----------------------------------------------------------------------------------------------------------------------
+
+int stringCompareStringRange(const i8* s1, const i8* s2, const i8* s3);
+
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+// Random number generation
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+
+#define K_RANDOM_TABLE_SIZE     312
+
+typedef struct
+{
+    u64     table[K_RANDOM_TABLE_SIZE];
+    u64     index;
+}
+Random;
+
+// Initialise based on time.
+void randomInit(Random* R);
+
+// Initialise with a single seed value.
+void randomInitSeed(Random* R, u64 seed);
+
+// Initialise with an array of seeds.
+void randomInitArray(Random* R, u64* seeds, i64 len);
+
+// Return a 64-bit pseudo-random number.
+u64 random64(Random* R);
+
+// Return a random float inclusive [0, 1].
+f64 randomFloat(Random* R);
+
+// Return a random float exclusive [0, 1).
+f64 randomFloatNo1(Random* R);
+
+// Return a random float really exclusive (0, 1).
+f64 randomFloatNo0Or1(Random* R);
+
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+// CRC-32 API
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+
+// Checksum calculation
+u32 crc32(void* data, i64 len);
+u32 crc32Update(u32 crc, void* data, i64 len);
+
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+// SHA-1 API
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+
+typedef struct
+{
+    u32     state[5];
+    u32     count[2];
+    u8      digest[20];
+    u8      buffer[64];
+    bool    finalised;
+}
+Sha1;
+
+//
+// Initialisation
+//
+void sha1Init(Sha1* s);
+
+// The process functions will initialise, process and finalise in one step.
+void sha1ProcessBuffer(Sha1* s, const void* data, i64 numBytes);
+void sha1ProcessString(Sha1* s, String str);
+void sha1ProcessHexString(Sha1* s, String hexStr);
+void sha1ProcessData(Sha1* s, Data data);
+void sha1ProcessStream(Sha1* s, DataStream* ds);
+
+//
+// Updating & finalisation
+//
+void sha1Add(Sha1* s, const void* data, i64 numBytes);
+void sha1Finalise(Sha1* s);
+
+//
+// Conversion
+//
+String sha1Hex(Sha1* s);
+u64 sha1Hash64(Sha1* s);
+
+//
+// Testing
+//
+bool sha1Equal(Sha1* s1, Sha1* s2);
+
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+// Process spawning API
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+
+// Start a process
+bool processStartAndWait(const i8* fileName, int argc, const i8** argv);
+
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+// PNG writing
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+
+bool pngWrite(const char* fileName, u32* img, int width, int height);
+
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+// Regular Expressions
+//----------------------------------------------------------------------------------------------------------------------
+// Inspired by Rob Pike's simple regex code and Kokke's code at https://github.com/kokke/tiny-regex-c
+//----------------------------------------------------------------------------------------------------------------------
+
+#define K_NO_MATCH -1
+
+// This function is very BASIC.  Matches using these symbols:
+//
+//      .           matches any single character
+//      ^           matches beginning of input string
+//      $           matches end of input string
+//      *           matches zero or more occurrences of the previous character (greedy)
+//      +           matches one or more (greedy)
+//      ?           matches zero or one (non-greedy)
+//      [abc]       matches one of a, b, or c
+//      [^abc]      matches anything but a, b or c (broken)
+//      [a-zA-z]    matches character ranges
+//      \s          whitespace (\t, \f, \r, \n, \v, spaces)
+//      \S          non-whitespace
+//      \w          C-based Alphanumeric [a-zA-Z0-9_]
+//      \W          Non c-based alphanumeric
+//      \d          Digits, [0-9]
+//      \D          Non-digits
+//      \x          Hexadecimal digits, [0-9a-fA-F]
+//      \X          Non-hexadecimal digits
+//
+// Returns the position where the match was found or K_NO_MATCH if not match was found.
+int match(const i8 *regexp, const i8* text);
+
+// Pre-compiled version of a regular expression
+typedef struct RegEx RegEx;
+
+// Generate a pre-compiled version of the regular expression
+RegEx regexCompile(const i8* pattern);
+
+// Release the resources used my compiling the regular expression.
+void regexRelease(RegEx re);
+
+// Use a pre-compiled version of a regular expression for matching
+int regexMatch(RegEx regex, const i8* text);
+
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+// Geometry
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+
+typedef struct _Point
+{
+    int x;
+    int y;
+}
+Point, *PointRef;
+
+typedef struct _Size
+{
+    int w;
+    int h;
+}
+Size, *SizeRef;
+
+typedef struct _Rect
+{
+    int x, y;
+    int w, h;
+}
+Rect, *RectRef;
+
+Point pointMake(int x, int y);
+Size sizeMake(int w, int h);
+Rect rectMake(int x, int y, int w, int h);
+
+Rect rectUnion(Rect a, Rect b);
+Rect rectIntersect(Rect a, Rect b);
+
+void blit(
+    void* dst,              // The destination 2d array
+    Size dstSize,           // The destination 2d array size
+    const void* src,        // The source 2d array
+    Size srcSize,           // The source 2d array size
+    int dx, int dy,         // The coordinates in the destination 2d array to copy to.
+    int sx, int sy,         // The coordinates in the source 2d array to copy from
+    int w, int h,           // Dimensions of the rectangle that is copied (same for both source and destination).
+    int elemSize);          // Size of each element in the arrays
+
+
+
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------{INDEX}
+// INDEX
+//
+//  ARRAY       Array management
+//  CRC32       CRC-32 checksumming
+//  DATA        Data loading
+//  ENTRY       Entry point
+//  GEOMETRY    Geometry API
+//  HASH        Fast hashing
+//  HASHMAP     Hash maps
+//  MEMORY      Memory management
+//  PLATFORM    Platform-specific code
+//  PNG         Simple uncompressed PNG output (for debugging)
+//  POOL        Memory pools
+//  QUEUE       Ring buffer queues
+//  RANDOM      Random number generation
+//  REGEX       Regular expressions
+//  SHA1        SHA-1 checksumming
+//  SORT        Sorting
+//  SPAWN       Process spawning API
+//  STRING      String processing, arena strings, paths and string tables
+//  TIME        Time management
+//  TIMERWHEEL  Timer wheels
+//  TRACE       Trace zones
+//
+//----------------------------------------------------------------------------------------------------------------------
+
+#ifdef K_IMPLEMENTATION
+
+#include <time.h>
+
+#if K_OS_WIN32
+#   include <conio.h>
+#   include <fcntl.h>
+#   include <io.h>
+#elif K_OS_LINUX
+#   include <errno.h>
+#   include <fcntl.h>
+#   include <pthread.h>
+#   include <spawn.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <sys/syscall.h>
+#   include <sys/wait.h>
+#   include <unistd.h>
+#   if K_DATA_LOADER_URING
+#       include <linux/io_uring.h>
+#   endif
+// <sys/mman.h> only declares mremap and its flags with _GNU_SOURCE, so kore calls it through syscall.
+#   ifndef MREMAP_MAYMOVE
+#       define MREMAP_MAYMOVE 1
+#   endif
+#endif
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void debugBreakOnAlloc(int n)
+{
+#if K_OS_WIN32 && defined(_DEBUG)
+    _crtBreakAlloc = n;
+#endif
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void pr(const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+
+    prv(format, args);
+
+    va_end(args);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void prn(const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    prnv(format, args);
+    va_end(args);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+internal char gLogBuffer[1024];
+
+void prv(const char* format, va_list args)
+{
+    vsnprintf(gLogBuffer, 1024, format, args);
+#if K_OS_WIN32
+    OutputDebugStringA(gLogBuffer);
+#endif
+    printf("%s", gLogBuffer);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void prnv(const char *format, va_list args)
+{
+    prv(format, args);
+    pr("\n");
+}
+
+//----------------------------------------------------------------------------------------------------------------------{TIME}
+//----------------------------------------------------------------------------------------------------------------------
+// Time Management
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+
+
+// NOTES:
+//  Windows uses QueryPerformanceCounter
+//  POSIX uses clock_gettime
+//  MacOSX uses mach_get_time
+//  x86/x64 uses rdtsc if K_TIME_TSC is YES and the TSC is invariant
+//
+
+#if K_TIME_TSC && (K_CPU_X86 || K_CPU_X64)
+#   define K_TIME_USE_TSC YES
+#   if K_COMPILER_MSVC
+#       include <intrin.h>
+#   else
+#       include <cpuid.h>
+#       include <x86intrin.h>
+#   endif
+#else
+#   define K_TIME_USE_TSC NO
+#endif
+
+internal volatile i64 gTimeFrequency = 0;
+#if K_TIME_USE_TSC
+internal bool gTimeUseTsc = NO;
+#endif
+
+internal i64 __timeOsTicks()
+{
+#if K_OS_WIN32
+    LARGE_INTEGER t;
+    QueryPerformanceCounter(&t);
+    return t.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (i64)ts.tv_sec * 1000000000 + (i64)ts.tv_nsec;
+#endif
+}
+
+internal i64 __timeOsFrequency()
+{
+#if K_OS_WIN32
+    LARGE_INTEGER freq;
+    QueryPerformanceFrequency(&freq);
+    return freq.QuadPart;
+#else
+    return 1000000000;
+#endif
+}
+
+#if K_TIME_USE_TSC
+// The TSC can only be used as a clock if it runs at a constant rate in all power states (CPUID.80000007H:EDX[8]).
+internal bool __timeHasInvariantTsc()
+{
+#if K_COMPILER_MSVC
+    int regs[4];
+    __cpuid(regs, 0x80000000);
+    if ((u32)regs[0] < 0x80000007) return NO;
+    __cpuid(regs, 0x80000007);
+    return K_BOOL(regs[3] & (1 << 8));
+#else
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid_max(0x80000000, 0) < 0x80000007) return NO;
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return K_BOOL(edx & (1 << 8));
+#endif
+}
+#endif
+
+void timeInit()
+{
+    i64 freq = __timeOsFrequency();
+
+#if K_TIME_USE_TSC
+    if (__timeHasInvariantTsc())
+    {
+        // Count the TSC ticks over a known period of the OS clock.
+        i64 os0 = __timeOsTicks();
+        u64 tsc0 = __rdtsc();
+        i64 osEnd = os0 + freq * K_TIME_TSC_CALIBRATION / 1000;
+        i64 os1;
+        while ((os1 = __timeOsTicks()) < osEnd);
+        u64 tsc1 = __rdtsc();
+
+        freq = (i64)((f64)(tsc1 - tsc0) * (f64)freq / (f64)(os1 - os0));
+        gTimeUseTsc = YES;
+    }
+#endif
+
+    gTimeFrequency = freq;
+}
+
+i64 timeFrequency()
+{
+    if (!gTimeFrequency) timeInit();
+    return gTimeFrequency;
+}
+
+TimePoint timeNow()
+{
+    TimePoint t;
+    if (!gTimeFrequency) timeInit();
+#if K_TIME_USE_TSC
+    if (gTimeUseTsc)
+    {
+        t.QuadPart = (i64)__rdtsc();
+        return t;
+    }
+#endif
+    t.QuadPart = __timeOsTicks();
+    return t;
+}
+
+TimePeriod timePeriod(TimePoint a, TimePoint b)
+{
+    TimePeriod t;
+    t.QuadPart = b.QuadPart - a.QuadPart;
+    return t;
+}
+
+TimePoint timeFuture(TimePoint t, TimePeriod p)
+{
+    t.QuadPart += p.QuadPart;
+    return t;
+}
+
+TimePeriod timeSecs(f64 time)
+{
+    TimePeriod t;
+    t.QuadPart = (i64)(time * (f64)timeFrequency());
+    return t;
+}
+
+TimePeriod timeMsecs(i64 ms)
+{
+    TimePeriod t;
+    t.QuadPart = ms * timeFrequency() / 1000;
+    return t;
+}
+
+i64 timeToMSecs(TimePeriod period)
+{
+    return period.QuadPart * 1000 / timeFrequency();
+}
+
+f64 timeToSecs(TimePeriod period)
+{
+    return (f64)period.QuadPart / (f64)timeFrequency();
+}
+
+void timeWaitFor(TimePeriod time)
+{
+    TimePoint futureTime = timeFuture(timeNow(), time);
+    timeWaitUntil(futureTime);
+}
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#   define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+internal K_THREAD_LOCAL TimeWaitStats gTimeWaitStats;
+
+#if K_OS_WIN32
+internal K_THREAD_LOCAL HANDLE gTimeWaitTimer = 0;
+internal K_THREAD_LOCAL bool gTimeWaitTimerTried = NO;
+#endif
+
+internal void __timeSleep(f64 secs)
+{
+#if K_OS_WIN32
+    // High resolution timers (Windows 10 1803+) wake within about half a millisecond.  Otherwise Sleep is only as good as
+    // the system timer resolution.
+    if (!gTimeWaitTimerTried)
+    {
+        gTimeWaitTimer = CreateWaitableTimerExW(0, 0, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+        gTimeWaitTimerTried = YES;
+    }
+    if (gTimeWaitTimer)
+    {
+        // Negative due times are relative, in units of 100ns.
+        LARGE_INTEGER due;
+        due.QuadPart = -(LONGLONG)(secs * 1e7);
+        if (SetWaitableTimer(gTimeWaitTimer, &due, 0, 0, 0, FALSE))
+        {
+            WaitForSingleObject(gTimeWaitTimer, INFINITE);
+            return;
+        }
+    }
+    Sleep((DWORD)(secs * 1000));
+#else
+    // Sleep until an absolute time so that being interrupted doesn't lengthen the sleep.
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    i64 ns = (i64)ts.tv_sec * 1000000000 + (i64)ts.tv_nsec + (i64)(secs * 1e9);
+    ts.tv_sec = (time_t)(ns / 1000000000);
+    ts.tv_nsec = (long)(ns % 1000000000);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, 0) == EINTR);
+#endif
+}
+
+internal void __timePause()
+{
+#if K_CPU_X86 || K_CPU_X64
+    _mm_pause();
+#endif
+}
+
+internal void __timeRecordOversleep(TimeWaitStats* stats, f64 over)
+{
+    f64 alpha = 1.0 / (f64)K_MIN(++stats->sleeps, K_TIME_WAIT_HISTORY);
+    f64 delta = over - stats->oversleep;
+    stats->oversleep += alpha * delta;
+    stats->oversleepDev += alpha * ((delta < 0 ? -delta : delta) - stats->oversleepDev);
+    stats->spinTime = K_MAX(stats->oversleep + 3 * stats->oversleepDev, 0);
+}
+
+void timeWaitUntil(TimePoint time)
+{
+    TimeWaitStats* stats = &gTimeWaitStats;
+    TimePoint now = timeNow();
+
+    if (now.QuadPart >= time.QuadPart) return;
+    if (!stats->sleeps) stats->spinTime = K_TIME_WAIT_SPIN_US * 1e-6;
+    ++stats->waits;
+
+    // Sleep until we're within the spin time of the deadline.  If a sleep wakes early, sleep again.
+    for (;;)
+    {
+        f64 remaining = timeToSecs(timePeriod(now, time));
+        if (remaining <= stats->spinTime) break;
+
+        f64 request = remaining - stats->spinTime;
+        __timeSleep(request);
+        TimePoint woken = timeNow();
+        __timeRecordOversleep(stats, timeToSecs(timePeriod(now, woken)) - request);
+        now = woken;
+    }
+
+    // Spin for the rest.
+    while (now.QuadPart < time.QuadPart)
+    {
+        __timePause();
+        now = timeNow();
+    }
+
+    f64 late = timeToSecs(timePeriod(time, now));
+    stats->lateMean += (late - stats->lateMean) / (f64)stats->waits;
+    if (late > stats->lateMax) stats->lateMax = late;
+}
+
+TimeWaitStats timeWaitStats()
+{
+    return gTimeWaitStats;
+}
+
+TimePeriod timeAdd(TimePeriod a, TimePeriod b)
+{
+    TimePeriod t;
+    t.QuadPart = a.QuadPart + b.QuadPart;
+    return t;
+}
+
+int timeCompare(TimePeriod a, TimePeriod b)
+{
+    if (a.QuadPart < b.QuadPart)
+    {
+        return -1;
+    }
+    else if (a.QuadPart > b.QuadPart)
+    {
+        return 1;
+    }
+    else
+    {
+        return 0;
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------{TIMERWHEEL}
+//----------------------------------------------------------------------------------------------------------------------
+// Timer wheels
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+
+#define K_TIMER_WHEEL_MASK (K_TIMER_WHEEL_SLOTS - 1)
+#define K_TIMER_WHEEL_RANGE ((i64)1 << (K_TIMER_WHEEL_BITS * K_TIMER_WHEEL_LEVELS))
+
+void timerWheelInit(TimerWheel* wheel, TimePeriod resolution)
+{
+    memoryClear(wheel, sizeof(*wheel));
+    handlePoolInit(&wheel->timers, sizeof(TimerNode));
+    wheel->start = timeNow();
+    wheel->resolution = resolution;
+    wheel->tick = 0;
+}
+
+void timerWheelDone(TimerWheel* wheel)
+{
+    handlePoolDone(&wheel->timers);
+    memoryClear(wheel->slots, sizeof(wheel->slots));
+}
+
+internal i64 __timerWheelTicks(TimerWheel* wheel, TimePeriod period, bool roundUp)
+{
+    i64 res = wheel->resolution.QuadPart;
+    return roundUp ? (period.QuadPart + res - 1) / res : period.QuadPart / res;
+}
+
+internal void __timerWheelUnlink(TimerNode* node)
+{
+    if (node->prev)
+    {
+        node->prev->next = node->next;
+    }
+    else
+    {
+        *node->list = node->next;
+    }
+    if (node->next) node->next->prev = node->prev;
+    node->list = 0;
+}
+
+internal void __timerWheelInsert(TimerWheel* wheel, TimerNode* node)
+{
+    i64 expiry = node->expiry;
+    i64 delta = expiry - wheel->tick;
+
+    // Park timers beyond the range of the wheel in the furthest slot.  They are reinserted when that slot cascades.
+    if (delta >= K_TIMER_WHEEL_RANGE)
+    {
+        expiry = wheel->tick + K_TIMER_WHEEL_RANGE - 1;
+        delta = K_TIMER_WHEEL_RANGE - 1;
+    }
+
+    int level = 0;
+    while (delta >= ((i64)1 << (K_TIMER_WHEEL_BITS * (level + 1)))) ++level;
+
+    TimerNode** list = &wheel->slots[level][(expiry >> (K_TIMER_WHEEL_BITS * level)) & K_TIMER_WHEEL_MASK];
+    node->list = list;
+    node->prev = 0;
+    node->next = *list;
+    if (*list) (*list)->prev = node;
+    *list = node;
+}
+
+// Move the timers in a slot down to the lower levels.
+internal void __timerWheelCascade(TimerWheel* wheel, int level, int slot)
+{
+    TimerNode* node = wheel->slots[level][slot];
+    wheel->slots[level][slot] = 0;
+    while (node)
+    {
+        TimerNode* next = node->next;
+        __timerWheelInsert(wheel, node);
+        node = next;
+    }
+}
+
+Handle timerWheelAdd(TimerWheel* wheel, TimePeriod delay, TimePeriod repeat, TimerFunc func, void* data)
+{
+    Handle handle;
+    TimerNode* node = (TimerNode *)handlePoolAcquire(&wheel->timers, &handle);
+    if (!node) return 0;
+
+    // Count the delay from the current time rather than the last tick processed so that timers never fire early.
+    i64 now = __timerWheelTicks(wheel, timePeriod(wheel->start, timeNow()), NO);
+    node->expiry = K_MAX(now, wheel->tick) + K_MAX(__timerWheelTicks(wheel, delay, YES), 1);
+    node->interval = repeat.QuadPart > 0 ? K_MAX(__timerWheelTicks(wheel, repeat, YES), 1) : 0;
+    node->func = func;
+    node->data = data;
+    node->handle = handle;
+    __timerWheelInsert(wheel, node);
+    return handle;
+}
+
+bool timerWheelCancel(TimerWheel* wheel, Handle timer)
+{
+    TimerNode* node = (TimerNode *)handlePoolGet(&wheel->timers, timer);
+    if (!node) return NO;
+    if (node->list) __timerWheelUnlink(node);
+    handlePoolRecycle(&wheel->timers, timer);
+    return YES;
+}
+
+i64 timerWheelAdvance(TimerWheel* wheel, TimePoint now)
+{
+    i64 target = __timerWheelTicks(wheel, timePeriod(wheel->start, now), NO);
+    i64 numFired = 0;
+
+    while (wheel->tick < target)
+    {
+        if (!timerWheelCount(wheel))
+        {
+            // Nothing to do, so catch up in one go.
+            wheel->tick = target;
+            break;
+        }
+
+        i64 tick = ++wheel->tick;
+
+        // When a wheel wraps, cascade the next slot of each level above it, highest first.
+        int top = 0;
+        while (top + 1 < K_TIMER_WHEEL_LEVELS && !(tick & (((i64)1 << (K_TIMER_WHEEL_BITS * (top + 1))) - 1))) ++top;
+        for (int level = top; level > 0; --level)
+        {
+            __timerWheelCascade(wheel, level, (int)((tick >> (K_TIMER_WHEEL_BITS * level)) & K_TIMER_WHEEL_MASK));
+        }
+
+        // Fire the timers in this tick's slot.  New timers are always added to a later slot, so this terminates.
+        TimerNode** list = &wheel->slots[0][tick & K_TIMER_WHEEL_MASK];
+        while (*list)
+        {
+            TimerNode* node = *list;
+            Handle handle = node->handle;
+            __timerWheelUnlink(node);
+            node->func(handle, node->data);
+            ++numFired;
+
+            // The callback may have cancelled the timer.
+            if (handlePoolGet(&wheel->timers, handle) != node) continue;
+            if (node->interval)
+            {
+                // Skip any repeats that were missed while the wheel wasn't advanced.
+                node->expiry += node->interval;
+                if (node->expiry <= tick) node->expiry += ((tick - node->expiry) / node->interval + 1) * node->interval;
+                __timerWheelInsert(wheel, node);
+            }
+            else
+            {
+                handlePoolRecycle(&wheel->timers, handle);
+            }
+        }
+    }
+
+    return numFired;
+}
+
+bool timerWheelNext(TimerWheel* wheel, TimePoint* outTime)
+{
+    if (!timerWheelCount(wheel)) return NO;
+
+    // The first occupied slot of each level gives a lower bound on when its timers fire.
+    i64 earliest = wheel->tick + K_TIMER_WHEEL_RANGE;
+    for (int level = 0; level < K_TIMER_WHEEL_LEVELS; ++level)
+    {
+        int shift = K_TIMER_WHEEL_BITS * level;
+        i64 pos = wheel->tick >> shift;
+        for (i64 i = 1; i <= K_TIMER_WHEEL_SLOTS; ++i)
+        {
+            if (wheel->slots[level][(pos + i) & K_TIMER_WHEEL_MASK])
+            {
+                earliest = K_MIN(earliest, K_MAX((pos + i) << shift, wheel->tick + 1));
+                break;
+            }
+        }
+    }
+
+    outTime->QuadPart = wheel->start.QuadPart + earliest * wheel->resolution.QuadPart;
+    return YES;
+}
+
+//----------------------------------------------------------------------------------------------------------------------{TRACE}
+//----------------------------------------------------------------------------------------------------------------------
+// Tracing
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+
+typedef struct
+{
+    i64             time;
+    const char*     name;           // 0 for the end of a zone.
+}
+TraceEvent;
+
+typedef struct
+{
+    volatile i64    head;           // Number of events recorded.
+    i64             tail;           // Number of events flushed.
+    i64             depth;          // Number of zones still open at the last flush.
+    i64             thread;
+    TraceEvent      events[K_TRACE_EVENTS];
+}
+TraceBuffer;
+
+internal TraceBuffer* volatile gTraceBuffers[K_TRACE_THREADS];
+internal volatile i64 gTraceNumBuffers = 0;
+internal K_THREAD_LOCAL TraceBuffer* gTraceBuffer = 0;
+internal K_THREAD_LOCAL bool gTraceUntraced = NO;
+
+internal void __traceRecord(const char* name)
+{
+    TraceBuffer* buffer = gTraceBuffer;
+
+    if (!buffer)
+    {
+        // First event on this thread.
+        if (gTraceUntraced) return;
+        i64 index = K_ATOMIC_ADD(&gTraceNumBuffers, 1);
+        if (index >= K_TRACE_THREADS)
+        {
+            gTraceUntraced = YES;
+            return;
+        }
+        buffer = (TraceBuffer *)K_ALLOC_CLEAR(sizeof(TraceBuffer));
+        buffer->thread = index + 1;
+        gTraceBuffers[index] = buffer;
+        gTraceBuffer = buffer;
+    }
+
+    // Fill in the event before publishing it by moving the head.
+    i64 head = buffer->head;
+    TraceEvent* e = &buffer->events[head & (K_TRACE_EVENTS - 1)];
+    e->time = timeNow().QuadPart;
+    e->name = name;
+    K_ATOMIC_STORE(&buffer->head, head + 1);
+}
+
+void traceBegin(const char* name)
+{
+    __traceRecord(name);
+}
+
+void traceEnd()
+{
+    __traceRecord(0);
+}
+
+i64 traceFlush(FILE* f)
+{
+    i64 numBuffers = K_MIN(K_ATOMIC_LOAD(&gTraceNumBuffers), K_TRACE_THREADS);
+    f64 usPerTick = 1e6 / (f64)timeFrequency();
+    i64 numEvents = 0;
+    TraceEvent* events = (TraceEvent *)K_ALLOC(sizeof(TraceEvent) * K_TRACE_EVENTS);
+
+    fprintf(f, "{ \"traceEvents\": [\n");
+    for (i64 b = 0; b < numBuffers; ++b)
+    {
+        TraceBuffer* buffer = gTraceBuffers[b];
+        if (!buffer) continue;
+
+        // Events older than a ring's length have been overwritten.  The thread may still be recording, so copy the
+        // events out and then drop any that it overwrote while we copied them.
+        i64 head = K_ATOMIC_LOAD(&buffer->head);
+        i64 start = K_MAX(buffer->tail, head - K_TRACE_EVENTS);
+        for (i64 i = start; i < head; ++i)
+        {
+            events[i & (K_TRACE_EVENTS - 1)] = buffer->events[i & (K_TRACE_EVENTS - 1)];
+        }
+        K_ATOMIC_FENCE();
+        start = K_MAX(start, K_ATOMIC_LOAD(&buffer->head) - K_TRACE_EVENTS + 1);
+
+        // Zones still open at the last flush end in this one, unless events were lost in between.  Any ends of zones
+        // whose beginning was overwritten are skipped.
+        i64 depth = start == buffer->tail ? buffer->depth : 0;
+        for (i64 i = start; i < head; ++i)
+        {
+            TraceEvent* e = &events[i & (K_TRACE_EVENTS - 1)];
+            if (e->name)
+            {
+                ++depth;
+                fprintf(f, "%s{ \"name\": \"%s\", \"ph\": \"B\", \"pid\": 1, \"tid\": %lld, \"ts\": %.3f }",
+                    numEvents++ ? ",\n" : "", e->name, (long long)buffer->thread, (f64)e->time * usPerTick);
+            }
+            else if (depth)
+            {
+                --depth;
+                fprintf(f, "%s{ \"ph\": \"E\", \"pid\": 1, \"tid\": %lld, \"ts\": %.3f }",
+                    numEvents++ ? ",\n" : "", (long long)buffer->thread, (f64)e->time * usPerTick);
+            }
+        }
+        buffer->tail = head;
+        buffer->depth = depth;
+    }
+    fprintf(f, "\n] }\n");
+    K_FREE(events, sizeof(TraceEvent) * K_TRACE_EVENTS);
+
+    return numEvents;
+}
+
+//----------------------------------------------------------------------------------------------------------------------{ENTRY}
+//----------------------------------------------------------------------------------------------------------------------
+// Entry point
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+
+extern int kmain(int argc, char** argv);
+
+internal const char* gExePath = 0;
+
+int main(int argc, char** argv)
+{
+#if K_OS_WIN32 && K_DEBUG
+    _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
+#endif
+    timeInit();
+
+#if K_OS_WIN32
+    _get_pgmptr((char **)&gExePath);
+#elif K_OS_LINUX
+    static char exePath[4096];
+    ssize_t len = readlink("/proc/self/exe", exePath, sizeof(exePath) - 1);
+    exePath[len > 0 ? len : 0] = 0;
+    gExePath = len > 0 ? exePath : argv[0];
+#else
+#   error Implement executable path query for your OS.
+#endif
+    return kmain(argc, argv);
+}
+
+#if K_OS_WIN32
+int WINAPI WinMain(HINSTANCE inst, HINSTANCE prevInst, LPSTR cmdLine, int cmdShow)
+{
+#if K_DEBUG
+    _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
+#endif
+
+    gExePath = __argv[0];
+    timeInit();
+
+    int result = kmain(__argc, __argv);
+    return result;
+}
+#endif
+
+//----------------------------------------------------------------------------------------------------------------------{MEMORY}
+//----------------------------------------------------------------------------------------------------------------------
+// Memory
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+// Virtual memory
+//----------------------------------------------------------------------------------------------------------------------
+
+#define K_ROUND_UP(x, n) ((((x) + (n) - 1) / (n)) * (n))
+
+internal void* __memoryReserve(i64 numBytes)
+{
+#if K_OS_WIN32
+    return VirtualAlloc(0, (SIZE_T)numBytes, MEM_RESERVE, PAGE_NOACCESS);
+#elif K_OS_LINUX
+    void* p = mmap(0, (size_t)numBytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return p == MAP_FAILED ? 0 : p;
+#else
+#   error Implement virtual memory reservation for your OS.
+#endif
+}
+
+// Reserve address space for huge pages.  Sets committed to YES if explicit huge pages were obtained, in which case
+// the whole range is already committed.  numBytes must be a multiple of K_ARENA_HUGE_PAGE.
+internal void* __memoryReserveHuge(i64 numBytes, bool* committed)
+{
+    *committed = NO;
+#if K_OS_WIN32
+    SIZE_T largePage = GetLargePageMinimum();
+    if (largePage && (numBytes % (i64)largePage) == 0)
+    {
+        // This requires the SeLockMemoryPrivilege.
+        void* p = VirtualAlloc(0, (SIZE_T)numBytes, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+        if (p)
+        {
+            *committed = YES;
+            return p;
+        }
+    }
+    return __memoryReserve(numBytes);
+#elif K_OS_LINUX
+    u8* p = (u8 *)mmap(0, (size_t)numBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p != MAP_FAILED)
+    {
+        *committed = YES;
+        return p;
+    }
+
+    // Fall back to transparent huge pages.  These need the range to be aligned to the huge page size, so reserve
+    // more than we need and trim the ends.
+    p = (u8 *)__memoryReserve(numBytes + K_ARENA_HUGE_PAGE);
+    if (p)
+    {
+        u8* aligned = (u8 *)K_ROUND_UP((uintptr_t)p, (uintptr_t)K_ARENA_HUGE_PAGE);
+        if (aligned > p) munmap(p, (size_t)(aligned - p));
+        if (aligned < p + K_ARENA_HUGE_PAGE) munmap(aligned + numBytes, (size_t)(p + K_ARENA_HUGE_PAGE - aligned));
+        madvise(aligned, (size_t)numBytes, MADV_HUGEPAGE);
+        p = aligned;
+    }
+    return p;
+#endif
+}
+
+internal bool __memoryCommit(void* address, i64 numBytes)
+{
+#if K_OS_WIN32
+    return K_BOOL(VirtualAlloc(address, (SIZE_T)numBytes, MEM_COMMIT, PAGE_READWRITE) != 0);
+#elif K_OS_LINUX
+    return K_BOOL(mprotect(address, (size_t)numBytes, PROT_READ | PROT_WRITE) == 0);
+#endif
+}
+
+internal void __memoryDecommit(void* address, i64 numBytes)
+{
+#if K_OS_WIN32
+    VirtualFree(address, (SIZE_T)numBytes, MEM_DECOMMIT);
+#elif K_OS_LINUX
+    madvise(address, (size_t)numBytes, MADV_DONTNEED);
+    mprotect(address, (size_t)numBytes, PROT_NONE);
+#endif
+}
+
+internal void __memoryRelease(void* address, i64 numBytes)
+{
+#if K_OS_WIN32
+    VirtualFree(address, 0, MEM_RELEASE);
+#elif K_OS_LINUX
+    munmap(address, (size_t)numBytes);
+#endif
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Slab allocator
+//
+// Small blocks are allocated from size classes.  Each thread has a free list and a bump region per size class, and the
+// regions are carved from K_MEMORY_SLAB_CHUNK-sized chunks obtained from the OS.  Because every free passes the size of
+// the block, no header is stored and freeing is just a push onto the free list.  Chunks are never returned to the OS.
+// A block freed on a different thread to the one that allocated it just migrates to the freeing thread's free list.
+//----------------------------------------------------------------------------------------------------------------------
+
+#if K_MEMORY_SLAB
+
+#define K_MEMORY_SLAB_NUM_CLASSES   20
+#define K_MEMORY_SLAB_MAX           1024
+
+internal const i64 kSlabSizes[K_MEMORY_SLAB_NUM_CLASSES] = {
+    16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 448, 512, 640, 768, 896, 1024,
+};
+
+// Indexed by (size + 15) / 16.
+internal const u8 kSlabLookup[(K_MEMORY_SLAB_MAX / 16) + 1] = {
+     0,  0,  1,  2,  3,  4,  5,  6,  7,  8,  8,  9,  9, 10, 10, 11,
+    11, 12, 12, 12, 12, 13, 13, 13, 13, 14, 14, 14, 14, 15, 15, 15,
+    15, 16, 16, 16, 16, 16, 16, 16, 16, 17, 17, 17, 17, 17, 17, 17,
+    17, 18, 18, 18, 18, 18, 18, 18, 18, 19, 19, 19, 19, 19, 19, 19,
+    19,
+};
+
+typedef struct
+{
+    void*   freeList;
+    u8*     cursor;
+    u8*     end;
+}
+SlabClass;
+
+internal K_THREAD_LOCAL SlabClass gSlabClasses[K_MEMORY_SLAB_NUM_CLASSES];
+
+// Return the size class for a block of numBytes, or -1 if it should be allocated from the C runtime.
+internal int __slabClass(i64 numBytes)
+{
+    return (numBytes > 0 && numBytes <= K_MEMORY_SLAB_MAX) ? (int)kSlabLookup[(numBytes + 15) >> 4] : -1;
+}
+
+internal void* __slabAlloc(int sizeClass)
+{
+    SlabClass* sc = &gSlabClasses[sizeClass];
+    i64 size = kSlabSizes[sizeClass];
+    void* p = sc->freeList;
+
+    if (p)
+    {
+        sc->freeList = *(void **)p;
+    }
+    else
+    {
+        if (sc->cursor + size > sc->end)
+        {
+            u8* chunk = (u8 *)__memoryReserve(K_MEMORY_SLAB_CHUNK);
+            if (!chunk) return 0;
+            if (!__memoryCommit(chunk, K_MEMORY_SLAB_CHUNK))
+            {
+                __memoryRelease(chunk, K_MEMORY_SLAB_CHUNK);
+                return 0;
+            }
+            sc->cursor = chunk;
+            sc->end = chunk + K_MEMORY_SLAB_CHUNK;
+        }
+
+        p = sc->cursor;
+        sc->cursor += size;
+    }
+
+    return p;
+}
+
+internal void __slabFree(void* p, int sizeClass)
+{
+    SlabClass* sc = &gSlabClasses[sizeClass];
+    *(void **)p = sc->freeList;
+    sc->freeList = p;
+}
+
+internal void* __memoryOpBase(void* oldAddress, i64 oldNumBytes, i64 newNumBytes, const char* file, int line)
+{
+    int oldClass = oldAddress ? __slabClass(oldNumBytes) : -1;
+    int newClass = newNumBytes ? __slabClass(newNumBytes) : -1;
+    void* p = 0;
+
+    if (oldClass < 0 && newClass < 0)
+    {
+        // Both sizes are handled by the C runtime.
+        if (newNumBytes)
+        {
+            p = realloc(oldAddress, newNumBytes);
+        }
+        else
+        {
+            free(oldAddress);
+        }
+    }
+    else if (oldClass == newClass)
+    {
+        // Block already fits in its size class.
+        p = oldAddress;
+    }
+    else
+    {
+        if (newNumBytes)
+        {
+            p = newClass < 0 ? malloc(newNumBytes) : __slabAlloc(newClass);
+            if (!p) return 0;
+            if (oldAddress) memoryCopy(oldAddress, p, K_MIN(oldNumBytes, newNumBytes));
+        }
+
+        if (oldAddress)
+        {
+            if (oldClass < 0) free(oldAddress); else __slabFree(oldAddress, oldClass);
+        }
+    }
+
+    return p;
+}
+
+#else
+
+internal void* __memoryOpBase(void* oldAddress, i64 oldNumBytes, i64 newNumBytes, const char* file, int line)
+{
+    void* p = 0;
+
+    if (newNumBytes)
+    {
+        p = realloc(oldAddress, newNumBytes);
+    }
+    else
+    {
+        free(oldAddress);
+    }
+
+    return p;
+}
+
+#endif // K_MEMORY_SLAB
+
+//----------------------------------------------------------------------------------------------------------------------
+// Allocation profiling
+//----------------------------------------------------------------------------------------------------------------------
+
+#if K_MEMORY_PROFILE
+
+typedef struct
+{
+    volatile i64    key;            // Hash of the file and line, 0 if unused or -1 while being claimed.
+    const char*     file;
+    int             line;
+    volatile i64    allocs;
+    volatile i64    reallocs;
+    volatile i64    frees;
+    volatile i64    liveBytes;
+    volatile i64    peakBytes;
+    volatile i64    totalBytes;
+    volatile i64    churnBytes;
+}
+MemoryProfileEntry;
+
+// Placed before each block.  16 bytes to keep the alignment of the block.
+typedef struct
+{
+    i64     site;
+    i64     reserved;
+}
+MemoryProfileHeader;
+
+internal MemoryProfileEntry gMemoryProfile[K_MEMORY_PROFILE_SITES];
+
+// Find or claim the table entry for a call site.  Returns -1 if the table is full.
+//
+// An entry is claimed by setting its key to -1, filling in the file and line, and then publishing the key, so another
+// thread never sees a key without its site.  The key is only a hash, so the site is compared as well.
+internal i64 __memoryProfileSite(const char* file, int line)
+{
+    u64 h = ((u64)(uintptr_t)file * 0x9e3779b97f4a7c15ull) ^ ((u64)line * 0xc2b2ae3d27d4eb4full);
+    i64 key = (i64)(h >> 1) | 1;
+    i64 mask = K_MEMORY_PROFILE_SITES - 1;
+    i64 slot = (i64)(h >> 32) & mask;
+
+    for (i64 i = 0; i < K_MEMORY_PROFILE_SITES; ++i, slot = (slot + 1) & mask)
+    {
+        MemoryProfileEntry* e = &gMemoryProfile[slot];
+        i64 current = K_ATOMIC_LOAD(&e->key);
+        if (current == 0)
+        {
+            current = K_ATOMIC_CAS(&e->key, 0, -1);
+            if (current == 0)
+            {
+                // We claimed the entry.
+                e->file = file;
+                e->line = line;
+                K_ATOMIC_STORE(&e->key, key);
+                return slot;
+            }
+        }
+        while (current == -1)
+        {
+            __timePause();
+            current = K_ATOMIC_LOAD(&e->key);
+        }
+        if (current == key && e->file == file && e->line == line) return slot;
+    }
+
+    return -1;
+}
+
+internal void __memoryProfileMax(volatile i64* peak, i64 value)
+{
+    i64 old = K_ATOMIC_LOAD(peak);
+    while (value > old)
+    {
+        i64 prev = K_ATOMIC_CAS(peak, old, value);
+        if (prev == old) break;
+        old = prev;
+    }
+}
+
+internal void* memoryOp(void* oldAddress, i64 oldNumBytes, i64 newNumBytes, const char* file, int line)
+{
+    i64 hdrSize = sizeof(MemoryProfileHeader);
+    MemoryProfileHeader* oldHdr = oldAddress ? (MemoryProfileHeader *)oldAddress - 1 : 0;
+    i64 oldSite = oldHdr ? oldHdr->site : -1;
+    MemoryProfileHeader* hdr = (MemoryProfileHeader *)__memoryOpBase(
+        oldHdr, oldHdr ? oldNumBytes + hdrSize : 0, newNumBytes ? newNumBytes + hdrSize : 0, file, line);
+
+    if (newNumBytes && !hdr) return 0;
+
+    if (oldSite >= 0)
+    {
+        MemoryProfileEntry* e = &gMemoryProfile[oldSite];
+        K_ATOMIC_ADD(&e->liveBytes, -oldNumBytes);
+        if (!newNumBytes) K_ATOMIC_ADD(&e->frees, 1);
+    }
+
+    if (hdr)
+    {
+        hdr->site = __memoryProfileSite(file, line);
+        if (hdr->site >= 0)
+        {
+            MemoryProfileEntry* e = &gMemoryProfile[hdr->site];
+            if (oldHdr)
+            {
+                K_ATOMIC_ADD(&e->reallocs, 1);
+                K_ATOMIC_ADD(&e->churnBytes, oldNumBytes);
+            }
+            else
+            {
+                K_ATOMIC_ADD(&e->allocs, 1);
+            }
+            K_ATOMIC_ADD(&e->totalBytes, newNumBytes);
+            __memoryProfileMax(&e->peakBytes, K_ATOMIC_ADD(&e->liveBytes, newNumBytes) + newNumBytes);
+        }
+
+        return hdr + 1;
+    }
+
+    return 0;
+}
+
+internal int __memoryProfileCompare(const void* a, const void* b)
+{
+    i64 pa = ((const MemorySite *)a)->peakBytes;
+    i64 pb = ((const MemorySite *)b)->peakBytes;
+    return pa < pb ? 1 : (pa > pb ? -1 : 0);
+}
+
+Array(MemorySite) memoryProfileSnapshot()
+{
+    Array(MemorySite) sites = 0;
+
+    for (i64 i = 0; i < K_MEMORY_PROFILE_SITES; ++i)
+    {
+        MemoryProfileEntry* e = &gMemoryProfile[i];
+        if (K_ATOMIC_LOAD(&e->key) > 0)
+        {
+            MemorySite* site = arrayNew(sites);
+            site->file = e->file;
+            site->line = e->line;
+            site->allocs = K_ATOMIC_LOAD(&e->allocs);
+            site->reallocs = K_ATOMIC_LOAD(&e->reallocs);
+            site->frees = K_ATOMIC_LOAD(&e->frees);
+            site->liveBytes = K_ATOMIC_LOAD(&e->liveBytes);
+            site->peakBytes = K_ATOMIC_LOAD(&e->peakBytes);
+            site->totalBytes = K_ATOMIC_LOAD(&e->totalBytes);
+            site->churnBytes = K_ATOMIC_LOAD(&e->churnBytes);
+        }
+    }
+
+    arraySort(sites, &__memoryProfileCompare);
+    return sites;
+}
+
+#else
+
+internal void* memoryOp(void* oldAddress, i64 oldNumBytes, i64 newNumBytes, const char* file, int line)
+{
+    return __memoryOpBase(oldAddress, oldNumBytes, newNumBytes, file, line);
+}
+
+Array(MemorySite) memoryProfileSnapshot()
+{
+    return 0;
+}
+
+#endif // K_MEMORY_PROFILE
+
+void memoryProfileDump(FILE* f)
+{
+    Array(MemorySite) sites = memoryProfileSnapshot();
+
+    fprintf(f, "%14s %14s %14s %14s %10s %10s %10s  %s\n",
+        "Live", "Peak", "Total", "Churn", "Allocs", "Reallocs", "Frees", "Site");
+    arrayFor(sites)
+    {
+        MemorySite* s = &sites[i];
+        fprintf(f, "%14lld %14lld %14lld %14lld %10lld %10lld %10lld  %s(%d)\n",
+            (long long)s->liveBytes, (long long)s->peakBytes, (long long)s->totalBytes, (long long)s->churnBytes,
+            (long long)s->allocs, (long long)s->reallocs, (long long)s->frees, s->file, s->line);
+    }
+
+    arrayDone(sites);
+}
+
+void memoryProfileDumpJson(FILE* f)
+{
+    Array(MemorySite) sites = memoryProfileSnapshot();
+
+    fprintf(f, "[\n");
+    arrayFor(sites)
+    {
+        MemorySite* s = &sites[i];
+
+        // File names on Windows contain backslashes, which need escaping.
+        fprintf(f, "  { \"file\": \"");
+        for (const char* c = s->file; *c; ++c)
+        {
+            if (*c == '\\' || *c == '"') fputc('\\', f);
+            fputc(*c, f);
+        }
+        fprintf(f, "\", \"line\": %d, \"live\": %lld, \"peak\": %lld, \"total\": %lld, \"churn\": %lld, "
+            "\"allocs\": %lld, \"reallocs\": %lld, \"frees\": %lld }%s\n",
+            s->line, (long long)s->liveBytes, (long long)s->peakBytes, (long long)s->totalBytes,
+            (long long)s->churnBytes, (long long)s->allocs, (long long)s->reallocs, (long long)s->frees,
+            i < arrayCount(sites) - 1 ? "," : "");
+    }
+    fprintf(f, "]\n");
+
+    arrayDone(sites);
+}
+
+void* memoryAlloc(i64 numBytes, const char* file, int line)
+{
+    return memoryOp(0, 0, numBytes, file, line);
+}
+
+void* memoryAllocClear(i64 numBytes, const char* file, int line)
+{
+    void* p = memoryOp(0, 0, numBytes, file, line);
+    memoryClear(p, numBytes);
+    return p;
+}
+
+void* memoryRealloc(void* address, i64 oldNumBytes, i64 newNumBytes, const char* file, int line)
+{
+    return memoryOp(address, oldNumBytes, newNumBytes, file, line);
+}
+
+void memoryFree(void* address, i64 numBytes, const char* file, int line)
+{
+    memoryOp(address, numBytes, 0, file, line);
+}
+
+void memoryCopy(const void* src, void* dst, i64 numBytes)
+{
+    memcpy(dst, src, (size_t)numBytes);
+}
+
+void memoryMove(const void* src, void* dst, i64 numBytes)
+{
+    memmove(dst, src, (size_t)numBytes);
+}
+
+int memoryCompare(const void* mem1, const void* mem2, i64 numBytes)
+{
+    return memcmp(mem1, mem2, (size_t)numBytes);
+}
+
+void memoryClear(void* mem, i64 numBytes)
+{
+    memset(mem, 0, (size_t)numBytes);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Arena control
+//----------------------------------------------------------------------------------------------------------------------
+
+//
+// Chained arenas have this header at the beginning of each block.  Blocks are linked to the previous block, and the
+// block after the current one is kept around (in next) after a pop so that pushing and popping across a block
+// boundary does not thrash malloc.
+//
+
+typedef struct ArenaBlock
+{
+    struct ArenaBlock*  prev;
+    struct ArenaBlock*  next;
+    i64                 base;       // Offset of the first byte of this block from the beginning of the chain.
+    i64                 size;       // Number of bytes in this block (not including the header).
+    volatile i64        used;       // AT_Concurrent: number of bytes claimed in this block.
+    i64                 reserved[3];    // Pad to 64 bytes so that the block's data is aligned like the block.
+}
+ArenaBlock;
+
+#define K_ARENA_BLOCK(arena) ((ArenaBlock *)(arena)->start - 1)
+#define K_ARENA_MAX_ALIGN 64
+
+//
+// Arena images start with this header.  It is 64 bytes so the mapped data has the same alignment as a chained block.
+//
+
+#define K_ARENA_IMAGE_MAGIC     0x4e52414b      // 'KARN'
+#define K_ARENA_IMAGE_VERSION   1
+
+typedef struct
+{
+    u32     magic;
+    u32     version;
+    i64     size;           // Number of bytes after the header.
+    u32     crc;            // CRC-32 of the bytes after the header.
+    u32     reserved[11];
+}
+ArenaImageHeader;
+
+internal void __dataUnmap(void* bytes, i64 size);
+internal void __arenaCacheRelease(Arena* arena);
+
+internal void* __arenaAlignedAlloc(i64 numBytes)
+{
+#if K_COMPILER_MSVC
+    return _aligned_malloc((size_t)numBytes, K_ARENA_MAX_ALIGN);
+#else
+    void* p = 0;
+    return posix_memalign(&p, K_ARENA_MAX_ALIGN, (size_t)numBytes) == 0 ? p : 0;
+#endif
+}
+
+internal void __arenaAlignedFree(void* p)
+{
+#if K_COMPILER_MSVC
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+internal ArenaBlock* __arenaBlockAlloc(ArenaBlock* prev, i64 size)
+{
+    ArenaBlock* block = (ArenaBlock *)__arenaAlignedAlloc(sizeof(ArenaBlock) + size);
+    if (block)
+    {
+        block->prev = prev;
+        block->next = 0;
+        block->base = prev ? prev->base + prev->size : 0;
+        block->size = size;
+        if (prev) prev->next = block;
+    }
+
+    return block;
+}
+
+// Free a block and all the blocks that follow it.
+internal void __arenaBlockFree(ArenaBlock* block)
+{
+    while (block)
+    {
+        ArenaBlock* next = block->next;
+        __arenaAlignedFree(block);
+        block = next;
+    }
+}
+
+internal void __arenaBlockUse(Arena* arena, ArenaBlock* block, i64 cursor)
+{
+    arena->start = (u8 *)(block + 1);
+    arena->end = arena->start + block->size;
+    arena->cursor = cursor;
+}
+
+// Convert an address in the current block to an offset that is valid across the whole arena.
+internal i64 __arenaOffset(Arena* arena, void* p)
+{
+    i64 offset = (i64)((u8 *)p - arena->start);
+    return arena->type == AT_Chained ? K_ARENA_BLOCK(arena)->base + offset : offset;
+}
+
+void arenaInit(Arena* arena, i64 initialSize)
+{
+    u8* buffer = (u8 *)__arenaAlignedAlloc(initialSize);
+    if (buffer)
+    {
+        arena->start = buffer;
+        arena->end = arena->start + initialSize;
+        arena->cursor = 0;
+        arena->restore = -1;
+        arena->type = AT_Realloc;
+        arena->limit = 0;
+        arena->highWater = 0;
+        arena->align = K_ARENA_ALIGN;
+        arena->hugePages = NO;
+    }
+}
+
+void arenaInitChained(Arena* arena, i64 blockSize)
+{
+    ArenaBlock* block = __arenaBlockAlloc(0, blockSize);
+    if (block)
+    {
+        __arenaBlockUse(arena, block, 0);
+        arena->restore = -1;
+        arena->type = AT_Chained;
+        arena->limit = 0;
+        arena->highWater = 0;
+        arena->align = K_ARENA_ALIGN;
+        arena->hugePages = NO;
+    }
+}
+
+void arenaInitVirtual(Arena* arena, i64 reserveSize, i64 highWater)
+{
+    i64 size = K_ROUND_UP(reserveSize, K_ARENA_COMMIT);
+    u8* buffer = (u8 *)__memoryReserve(size);
+    if (buffer)
+    {
+        if (__memoryCommit(buffer, K_ARENA_COMMIT))
+        {
+            arena->start = buffer;
+            arena->end = buffer + K_ARENA_COMMIT;
+            arena->cursor = 0;
+            arena->restore = -1;
+            arena->type = AT_Virtual;
+            arena->limit = buffer + size;
+            arena->highWater = highWater;
+            arena->align = K_ARENA_ALIGN;
+            arena->hugePages = NO;
+        }
+        else
+        {
+            __memoryRelease(buffer, size);
+        }
+    }
+}
+
+void arenaInitHuge(Arena* arena, i64 reserveSize)
+{
+    i64 size = K_ROUND_UP(reserveSize, K_ARENA_HUGE_PAGE);
+    bool committed = NO;
+    u8* buffer = (u8 *)__memoryReserveHuge(size, &committed);
+    if (buffer)
+    {
+        if (committed || __memoryCommit(buffer, K_ARENA_HUGE_PAGE))
+        {
+            arena->start = buffer;
+            arena->end = buffer + (committed ? size : K_ARENA_HUGE_PAGE);
+            arena->cursor = 0;
+            arena->restore = -1;
+            arena->type = AT_Virtual;
+            arena->limit = buffer + size;
+            arena->highWater = 0;
+            arena->align = K_ARENA_ALIGN;
+            arena->hugePages = YES;
+        }
+        else
+        {
+            __memoryRelease(buffer, size);
+        }
+    }
+}
+
+internal volatile i64 gArenaNextId = 0;
+
+void arenaInitConcurrent(Arena* arena, i64 blockSize)
+{
+    ArenaBlock* block = __arenaBlockAlloc(0, K_ROUND_UP(blockSize, K_ARENA_MAX_ALIGN));
+    if (block)
+    {
+        block->used = 0;
+        __arenaBlockUse(arena, block, 0);
+        arena->restore = -1;
+        arena->type = AT_Concurrent;
+        arena->limit = 0;
+        arena->highWater = 0;
+        arena->align = K_ARENA_ALIGN;
+        arena->hugePages = NO;
+        arena->id = K_ATOMIC_ADD(&gArenaNextId, 1) + 1;
+    }
+}
+
+void arenaSetAlign(Arena* arena, i64 align)
+{
+    K_ASSERT(align > 0 && (align & (align - 1)) == 0 && align <= K_ARENA_MAX_ALIGN, "Invalid arena alignment");
+    arena->align = align;
+}
+
+void arenaDone(Arena* arena)
+{
+    if ((arena->type == AT_Chained || arena->type == AT_Concurrent) && arena->start)
+    {
+        ArenaBlock* block = K_ARENA_BLOCK(arena);
+        while (block->prev) block = block->prev;
+        __arenaBlockFree(block);
+        if (arena->type == AT_Concurrent) __arenaCacheRelease(arena);
+    }
+    else if (arena->type == AT_Mapped && arena->start)
+    {
+        u8* image = arena->start - sizeof(ArenaImageHeader);
+        __dataUnmap(image, (i64)(arena->limit - image));
+    }
+    else if (arena->type == AT_Virtual && arena->start)
+    {
+        __memoryRelease(arena->start, (i64)(arena->limit - arena->start));
+    }
+    else
+    {
+        __arenaAlignedFree(arena->start);
+    }
+    arena->start = 0;
+    arena->end = 0;
+    arena->cursor = 0;
+    arena->restore = -1;
+}
+
+internal bool __arenaGrowChained(Arena* arena, i64 size)
+{
+    ArenaBlock* block = K_ARENA_BLOCK(arena);
+    ArenaBlock* next = block->next;
+
+    if (next && next->size < size)
+    {
+        // The cached block isn't big enough for this allocation.
+        __arenaAlignedFree(next);
+        block->next = next = 0;
+    }
+
+    if (!next)
+    {
+        i64 newSize = K_MAX(2 * block->size, K_MAX(size, K_ARENA_INCREMENT));
+        next = __arenaBlockAlloc(block, newSize);
+        if (!next) return NO;
+    }
+
+    __arenaBlockUse(arena, next, 0);
+    return YES;
+}
+
+//
+// Concurrent arenas
+//
+
+typedef struct
+{
+    i64     id;             // ID of the arena this chunk was carved from, 0 if unused.
+    u8*     cursor;
+    u8*     end;
+}
+ArenaCache;
+
+internal K_THREAD_LOCAL ArenaCache gArenaCaches[K_ARENA_CACHE_COUNT];
+
+// Give up this thread's cache slot for an arena.
+internal void __arenaCacheRelease(Arena* arena)
+{
+    for (int i = 0; i < K_ARENA_CACHE_COUNT; ++i)
+    {
+        if (gArenaCaches[i].id == arena->id) memoryClear(&gArenaCaches[i], sizeof(ArenaCache));
+    }
+}
+
+// Claim size bytes from the shared block, chaining on a new block if it is full.
+internal u8* __arenaClaimConcurrent(Arena* arena, i64 size)
+{
+    for (;;)
+    {
+        u8* start = (u8 *)K_ATOMIC_LOAD_PTR(&arena->start);
+        ArenaBlock* block = (ArenaBlock *)start - 1;
+        i64 offset = K_ATOMIC_ADD(&block->used, size);
+        if (offset + size <= block->size) return start + offset;
+
+        // The block is full.  Only one new block can be chained on to this one, so if another thread beats us to it,
+        // we use theirs.
+        ArenaBlock* next = (ArenaBlock *)K_ATOMIC_LOAD_PTR(&block->next);
+        if (!next)
+        {
+            ArenaBlock* newBlock = (ArenaBlock *)__arenaAlignedAlloc(
+                sizeof(ArenaBlock) + K_MAX(block->size, K_ROUND_UP(size, K_ARENA_MAX_ALIGN)));
+            if (!newBlock) return 0;
+            newBlock->prev = block;
+            newBlock->next = 0;
+            newBlock->base = block->base + block->size;
+            newBlock->size = K_MAX(block->size, K_ROUND_UP(size, K_ARENA_MAX_ALIGN));
+            newBlock->used = 0;
+
+            next = (ArenaBlock *)K_ATOMIC_CAS_PTR(&block->next, 0, newBlock);
+            if (next)
+            {
+                __arenaAlignedFree(newBlock);
+            }
+            else
+            {
+                next = newBlock;
+            }
+        }
+
+        // Move the arena on to the next block if nobody else has.
+        (void)K_ATOMIC_CAS_PTR(&arena->start, start, (u8 *)(next + 1));
+    }
+}
+
+internal void* __arenaAllocConcurrent(Arena* arena, i64 size)
+{
+    ArenaCache* cache = 0;
+    u8* p = 0;
+
+    // Keep allocations aligned so that neighbouring threads never share the alignment padding.
+    size = K_ROUND_UP(size, arena->align);
+
+    // Large allocations go straight to the shared block.
+    if (size > K_ARENA_CACHE_SIZE / 4) return __arenaClaimConcurrent(arena, size);
+
+    for (int i = 0; i < K_ARENA_CACHE_COUNT; ++i)
+    {
+        if (gArenaCaches[i].id == arena->id)
+        {
+            cache = &gArenaCaches[i];
+            break;
+        }
+    }
+
+    if (!cache)
+    {
+        // Take a free cache slot.  If every slot is caching another arena, allocate from the shared block rather than
+        // throw away the rest of another arena's chunk.
+        for (int i = 0; i < K_ARENA_CACHE_COUNT; ++i)
+        {
+            if (!gArenaCaches[i].id)
+            {
+                cache = &gArenaCaches[i];
+                break;
+            }
+        }
+        if (!cache) return __arenaClaimConcurrent(arena, size);
+        cache->id = arena->id;
+        cache->cursor = cache->end = 0;
+    }
+
+    if (cache->cursor + size > cache->end)
+    {
+        u8* chunk = __arenaClaimConcurrent(arena, K_ARENA_CACHE_SIZE);
+        if (!chunk) return 0;
+        cache->cursor = chunk;
+        cache->end = chunk + K_ARENA_CACHE_SIZE;
+    }
+
+    p = cache->cursor;
+    cache->cursor += size;
+    return p;
+}
+
+void* arenaAlloc(Arena* arena, i64 size)
+{
+    void* p = 0;
+    if (arena->type == AT_Concurrent) return __arenaAllocConcurrent(arena, size);
+    K_ASSERT(arena->type != AT_Mapped, "Mapped arenas are read-only");
+    if (arena->type == AT_Mapped) return 0;
+
+    if ((arena->start + arena->cursor + size) > arena->end)
+    {
+        // We don't have enough room
+        if (arena->type == AT_Chained)
+        {
+            if (__arenaGrowChained(arena, size))
+            {
+                p = arenaAlloc(arena, size);
+            }
+        }
+        else if (arena->type == AT_Virtual)
+        {
+            // Commit enough pages to cover the allocation.  The start of the arena never moves.
+            i64 commitSize = arena->hugePages ? K_ARENA_HUGE_PAGE : K_ARENA_COMMIT;
+            u8* newEnd = arena->start + K_ROUND_UP(arena->cursor + size, commitSize);
+            if (newEnd <= arena->limit && __memoryCommit(arena->end, (i64)(newEnd - arena->end)))
+            {
+                arena->end = newEnd;
+                p = arenaAlloc(arena, size);
+            }
+        }
+        else
+        {
+            i64 currentSize = (i64)(arena->end - (u8 *)arena->start);
+            i64 requiredSize = currentSize + size;
+            i64 newSize = currentSize + K_MAX(requiredSize, K_ARENA_INCREMENT);
+
+            // realloc can't keep the alignment, so copy into a new aligned block.
+            u8* newArena = (u8 *)__arenaAlignedAlloc(newSize);
+
+            if (newArena)
+            {
+                memoryCopy(arena->start, newArena, currentSize);
+                __arenaAlignedFree(arena->start);
+                arena->start = newArena;
+                arena->end = newArena + newSize;
+
+                // Try again!
+                p = arenaAlloc(arena, size);
+            }
+        }
+    }
+    else
+    {
+        p = arena->start + arena->cursor;
+        arena->cursor += size;
+    }
+
+    return p;
+}
+
+void* arenaAlign(Arena* arena)
+{
+    // Concurrent allocations are always aligned.
+    if (arena->type == AT_Concurrent) return 0;
+
+    i64 mod = arena->cursor & (arena->align - 1);
+    void* p = arena->start + arena->cursor;
+
+    if (mod)
+    {
+        // We need to align
+        i64 padding = arena->align - mod;
+        if (arena->type == AT_Chained && (arena->start + arena->cursor + padding) > arena->end)
+        {
+            // Padding into a new block would misalign it.  Use up this block instead so the next allocation starts a
+            // new aligned block.
+            arena->cursor = (i64)(arena->end - arena->start);
+        }
+        else
+        {
+            arenaAlloc(arena, padding);
+        }
+    }
+
+    return p;
+}
+
+void* arenaAlignedAlloc(Arena* arena, i64 numBytes)
+{
+    arenaAlign(arena);
+    void* p = arenaAlloc(arena, numBytes);
+    K_ASSERT(((uintptr_t)p & (arena->align - 1)) == 0, "Arena allocation is misaligned");
+    return p;
+}
+
+void arenaPush(Arena* arena)
+{
+    K_ASSERT(arena->type != AT_Concurrent && arena->type != AT_Mapped, "Arena does not support restore points");
+    arenaAlign(arena);
+    {
+        i64* p = arenaAlloc(arena, sizeof(i64) * 2);
+        p[0] = 0xaaaaaaaaaaaaaaaa;
+        p[1] = arena->restore;
+        arena->restore = __arenaOffset(arena, p);
+    }
+}
+
+void arenaPop(Arena* arena)
+{
+    i64* p = 0;
+    K_ASSERT(arena->restore != -1, "Make sure we have some restore points left");
+    if (arena->type == AT_Chained)
+    {
+        // Walk back to the block containing the restore point and free all but the block after it.
+        ArenaBlock* block = K_ARENA_BLOCK(arena);
+        ArenaBlock* spare = 0;
+        while (block->base > arena->restore) block = block->prev;
+        spare = block->next;
+        if (spare)
+        {
+            __arenaBlockFree(spare->next);
+            spare->next = 0;
+        }
+        __arenaBlockUse(arena, block, arena->restore - block->base);
+    }
+    else
+    {
+        arena->cursor = arena->restore;
+        if (arena->type == AT_Virtual && arena->highWater)
+        {
+            // Give back the pages above the high-water mark, keeping the restore point itself committed.
+            i64 keep = K_MAX(arena->cursor + (i64)sizeof(i64) * 2, arena->highWater);
+            u8* keepEnd = arena->start + K_ROUND_UP(keep, K_ARENA_COMMIT);
+            if (keepEnd < arena->end)
+            {
+                __memoryDecommit(keepEnd, (i64)(arena->end - keepEnd));
+                arena->end = keepEnd;
+            }
+        }
+    }
+    p = (i64 *)(arena->start + arena->cursor);
+    p[0] = 0xbbbbbbbbbbbbbbbb;
+    arena->restore = p[1];
+}
+
+i64 arenaSpace(Arena* arena)
+{
+    return (arena->end - arena->start) - arena->cursor;
+}
+
+char* arenaFormatV(Arena* arena, const char* format, va_list args)
+{
+    i64 maxSize = 0;
+    char* p = 0;
+
+    K_ASSERT(arena->type != AT_Mapped, "Mapped arenas are read-only");
+    if (arena->type == AT_Mapped) return 0;
+
+    // A va_list can only be used once, so keep a copy for the second attempt.
+    va_list argsCopy;
+    va_copy(argsCopy, args);
+
+    if (arena->type == AT_Concurrent)
+    {
+        // Other threads own the space past the cursor, so measure the string first and print into our own allocation.
+        int numChars = vsnprintf(0, 0, format, argsCopy);
+        p = (char *)arenaAlloc(arena, numChars + 1);
+        if (p) vsnprintf(p, numChars + 1, format, args);
+        va_end(argsCopy);
+        return p;
+    }
+
+    maxSize = arenaSpace(arena);
+    int numChars = vsnprintf(arena->start + arena->cursor, maxSize, format, args);
+    if (numChars < maxSize)
+    {
+        // The string fit in the space left.
+        p = (char *)arenaAlloc(arena, numChars + 1);
+    }
+    else
+    {
+        // There wasn't enough room to hold the string.  Allocate more and try again.
+        p = (char *)arenaAlloc(arena, numChars + 1);
+        numChars = vsnprintf(p, numChars + 1, format, argsCopy);
+    }
+
+    va_end(argsCopy);
+    return p;
+}
+
+char* arenaFormat(Arena* arena, const char* format, ...)
+{
+    va_list(args);
+    va_start(args, format);
+    char* p = arenaFormatV(arena, format, args);
+    va_end(args);
+    return p;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Scratch arenas
+//----------------------------------------------------------------------------------------------------------------------
+
+internal K_THREAD_LOCAL Arena gScratch[K_SCRATCH_COUNT];
+
+Scratch scratchBegin(Arena* conflict)
+{
+    Scratch scratch = { 0 };
+
+    for (int i = 0; i < K_SCRATCH_COUNT; ++i)
+    {
+        Arena* arena = &gScratch[i];
+        if (arena == conflict) continue;
+
+        if (!arena->start)
+        {
+            arenaInitVirtual(arena, K_ARENA_RESERVE, K_SCRATCH_HIGHWATER);
+            if (!arena->start) break;
+        }
+
+        arenaPush(arena);
+        scratch.arena = arena;
+        break;
+    }
+
+    K_ASSERT(scratch.arena, "Could not obtain a scratch arena.");
+    return scratch;
+}
+
+void scratchEnd(Scratch scratch)
+{
+    arenaPop(scratch.arena);
+}
+
+void scratchDone()
+{
+    for (int i = 0; i < K_SCRATCH_COUNT; ++i)
+    {
+        if (gScratch[i].start) arenaDone(&gScratch[i]);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------{ARRAY}
+//----------------------------------------------------------------------------------------------------------------------
+// Arrays
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+
+internal void* __arrayInternalGrowArena(void* a, i64 capacity, i64 elemSize)
+{
+    Arena* arena = __arrayArena(a);
+    i64 oldCapacity = __arrayCapacity(a);
+    u8* arrayEnd = (u8 *)a + elemSize * oldCapacity;
+    i64 extraBytes = elemSize * (capacity - oldCapacity);
+
+    if (arrayEnd == arena->start + arena->cursor && (arena->type == AT_Virtual || arenaSpace(arena) >= extraBytes))
+    {
+        // We're the last allocation on the arena and there's room to grow without moving.
+        if (!arenaAlloc(arena, extraBytes)) return 0;
+        __arrayRaw(a)[0] = capacity | K_ARRAY_ARENA;
+        return a;
+    }
+    else
+    {
+        // Realloc arenas move their allocations when they grow, so track the old array by offset.
+        i64 offset = (i64)((u8 *)a - arena->start);
+        i64 count = __arrayCount(a);
+        u8* b = (u8 *)__arrayInternalInitArena(arena, capacity, elemSize);
+        if (b)
+        {
+            if (arena->type == AT_Realloc) a = arena->start + offset;
+            memoryCopy(a, b, elemSize * count);
+            __arrayCount(b) = count;
+        }
+        return b;
+    }
+}
+
+void* __arrayInternalInitArena(Arena* arena, i64 capacity, i64 elemSize)
+{
+    i64* p = (i64 *)arenaAlignedAlloc(arena, elemSize * capacity + sizeof(i64) * 4);
+    if (p)
+    {
+        *(Arena **)p = arena;
+        p[1] = 0;
+        p[2] = capacity | K_ARRAY_ARENA;
+        p[3] = 0;
+        return p + 4;
+    }
+    else
+    {
+        return 0;
+    }
+}
+
+void* __arrayInternalGrow(void* a, i64 increment, i64 elemSize)
+{
+    i64 doubleCurrent = a ? 2 * __arrayCapacity(a) : 0;
+    i64 minNeeded = arrayCount(a) + increment;
+    i64 capacity = doubleCurrent > minNeeded ? doubleCurrent : minNeeded;
+    if (a && __arrayIsArena(a)) return __arrayInternalGrowArena(a, capacity, elemSize);
+    if (a && __arrayIsInline(a))
+    {
+        // Spill the inline storage to the heap.
+        i64* p = (i64 *)K_ALLOC(elemSize * capacity + sizeof(i64) * 2);
+        if (p)
+        {
+            p[0] = capacity;
+            p[1] = __arrayCount(a);
+            memoryCopy(a, p + 2, elemSize * __arrayCount(a));
+            return p + 2;
+        }
+        return 0;
+    }
+
+    i64 oldBytes = a ? elemSize * __arrayCapacity(a) + sizeof(i64) * 2 : 0;
+    i64 bytes = elemSize * capacity + sizeof(i64) * 2;
+    i64* p = (i64 *)K_REALLOC(a ? __arrayRaw(a) : 0, oldBytes, bytes);
+    if (p)
+    {
+        if (!a) p[1] = 0;
+        p[0] = capacity;
+        return p + 2;
+    }
+    else
+    {
+        return 0;
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------{POOL}
+//----------------------------------------------------------------------------------------------------------------------
+// Pools
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+
+// The occupancy bitmap follows the elements, with one bit per element that is set while the element is acquired.
+#define __poolBitmapOffset(capacity, elemSize) K_ROUND_UP((capacity) * (elemSize), sizeof(u64))
+#define __poolBitmapWords(capacity) (((capacity) + 63) / 64)
+#define __poolBitmap(p, elemSize) ((u64 *)((u8 *)(p) + __poolBitmapOffset(__poolCapacity(p), (elemSize))))
+#define __poolBytes(capacity, elemSize) \
+    (sizeof(i64) * 2 + __poolBitmapOffset((capacity), (elemSize)) + __poolBitmapWords(capacity) * sizeof(u64))
+
+internal int __poolFirstBit(u64 mask)
+{
+#if K_COMPILER_MSVC
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctzll(mask);
+#endif
+}
+
+void* __poolInternalAcquire(void* p, i64 increment, i64 elemSize, void** outP)
+{
+    // Test for capacity
+    // If this assert triggers, the element size is too small for a pool.
+    K_ASSERT(elemSize >= sizeof(i64));
+    if (!p || (__poolFreeList(p) == __poolCapacity(p)))
+    {
+        // We have no more room
+        i64 oldCapacity = p ? __poolCapacity(p) : 0;
+        i64 doubleCurrent = 2 * oldCapacity;
+        i64 minNeeded = (p ? __poolCapacity(p) : 0) + 1;
+        i64 capacity = doubleCurrent > minNeeded ? doubleCurrent : minNeeded;
+        i64 oldBytes = p ? __poolBytes(oldCapacity, elemSize) : 0;
+        i64 bytes = __poolBytes(capacity, elemSize);
+        i64* newP = (i64 *)K_REALLOC(p ? __poolRaw(p) : 0, oldBytes, bytes);
+        if (newP)
+        {
+            newP[0] = capacity;
+            if (!p) newP[1] = 0;
+            u8* b = (u8 *)(newP + 2);
+
+            // Move the bitmap to its new place after the elements before the new elements overwrite it.
+            i64 oldWords = __poolBitmapWords(oldCapacity);
+            i64 newWords = __poolBitmapWords(capacity);
+            u64* bitmap = (u64 *)(b + __poolBitmapOffset(capacity, elemSize));
+            memmove(bitmap, b + __poolBitmapOffset(oldCapacity, elemSize), oldWords * sizeof(u64));
+            memset(bitmap + oldWords, 0, (newWords - oldWords) * sizeof(u64));
+
+            for (i64 i = oldCapacity; i < capacity; ++i)
+            {
+                *(i64 *)(&b[i * elemSize]) = i + 1;
+            }
+        }
+        else
+        {
+            return 0;
+        }
+
+        p = newP + 2;
+    }
+
+    // Do the acquiring
+    u8* b = (u8 *)p;
+    i64 newIndex = __poolFreeList(p);
+    i64* b64 = (i64 *)&b[newIndex * elemSize];
+    __poolFreeList(p) = *b64;
+    __poolBitmap(p, elemSize)[newIndex / 64] |= (u64)1 << (newIndex % 64);
+    *outP = p;
+    return b64;
+}
+
+void __poolInternalRecycle(void* p, i64 index, i64 elemSize)
+{
+    u8* b = (u8 *)p;
+    i64* b64 = (i64 *)&b[index * elemSize];
+    *b64 = __poolFreeList(p);
+    __poolFreeList(p) = index;
+    __poolBitmap(p, elemSize)[index / 64] &= ~((u64)1 << (index % 64));
+}
+
+void __poolInternalDone(void* p, i64 elemSize)
+{
+    if (p) K_FREE(__poolRaw(p), __poolBytes(__poolCapacity(p), elemSize));
+}
+
+i64 __poolInternalNext(void* p, i64 elemSize, i64 index)
+{
+    if (!p) return -1;
+
+    // Scan 64 elements at a time, skipping the words with no acquired elements.
+    i64 capacity = __poolCapacity(p);
+    if (index >= capacity) return -1;
+    u64* bitmap = __poolBitmap(p, elemSize);
+    i64 w = index / 64;
+    u64 bits = bitmap[w] & (~(u64)0 << (index % 64));
+    i64 numWords = __poolBitmapWords(capacity);
+    while (!bits)
+    {
+        if (++w == numWords) return -1;
+        bits = bitmap[w];
+    }
+    return w * 64 + __poolFirstBit(bits);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Handle pools
+//----------------------------------------------------------------------------------------------------------------------
+
+#define K_HANDLE_INDEX_MASK ((1u << K_HANDLE_INDEX_BITS) - 1)
+#define K_HANDLE_GEN_MAX ((1u << K_HANDLE_GEN_BITS) - 1)
+
+void handlePoolInit(HandlePool* pool, i64 elemSize)
+{
+    pool->chunks = 0;
+    pool->elemSize = K_ROUND_UP(elemSize, sizeof(i64));
+    pool->count = 0;
+    pool->live = 0;
+    pool->freeList = -1;
+}
+
+void handlePoolDone(HandlePool* pool)
+{
+    i64 chunkBytes = __handlePoolDataOffset + K_HANDLE_POOL_CHUNK * pool->elemSize;
+    arrayFor(pool->chunks)
+    {
+        K_FREE(pool->chunks[i], chunkBytes);
+    }
+    arrayDone(pool->chunks);
+    pool->count = 0;
+    pool->live = 0;
+    pool->freeList = -1;
+}
+
+void* handlePoolAcquire(HandlePool* pool, Handle* outHandle)
+{
+    i64 index = pool->freeList;
+    HandlePoolChunk* chunk = 0;
+
+    if (index >= 0)
+    {
+        chunk = __handlePoolChunk(pool, index);
+        pool->freeList = (i64)(i32)chunk->next[index & (K_HANDLE_POOL_CHUNK - 1)];
+    }
+    else
+    {
+        index = pool->count;
+        if (index > K_HANDLE_INDEX_MASK) return 0;
+        if (index == arrayCount(pool->chunks) * K_HANDLE_POOL_CHUNK)
+        {
+            // We need a new chunk.  Generations start at 1 so that the handle 0 is never valid.
+            i64 chunkBytes = __handlePoolDataOffset + K_HANDLE_POOL_CHUNK * pool->elemSize;
+            chunk = (HandlePoolChunk *)K_ALLOC(chunkBytes);
+            if (!chunk) return 0;
+            memset(chunk->occupied, 0, sizeof(chunk->occupied));
+            for (int i = 0; i < K_HANDLE_POOL_CHUNK; ++i) chunk->gens[i] = 1;
+            arrayAdd(pool->chunks, (u8 *)chunk);
+        }
+        chunk = __handlePoolChunk(pool, index);
+        ++pool->count;
+    }
+
+    i64 slot = index & (K_HANDLE_POOL_CHUNK - 1);
+    u16* gen = &chunk->gens[slot];
+    *gen |= K_HANDLE_LIVE;
+    chunk->occupied[slot / 64] |= (u64)1 << (slot % 64);
+    ++pool->live;
+    if (outHandle) *outHandle = ((Handle)(*gen & K_HANDLE_GEN_MAX) << K_HANDLE_INDEX_BITS) | (Handle)index;
+    return handlePoolAt(pool, index);
+}
+
+void handlePoolRecycle(HandlePool* pool, Handle handle)
+{
+    if (!handlePoolGet(pool, handle)) return;
+
+    i64 index = (i64)(handle & K_HANDLE_INDEX_MASK);
+    HandlePoolChunk* chunk = __handlePoolChunk(pool, index);
+    i64 slot = index & (K_HANDLE_POOL_CHUNK - 1);
+
+    // Move on to the next generation, skipping 0.
+    chunk->gens[slot] = (u16)((chunk->gens[slot] & K_HANDLE_GEN_MAX) % K_HANDLE_GEN_MAX + 1);
+    chunk->occupied[slot / 64] &= ~((u64)1 << (slot % 64));
+    chunk->next[slot] = (u32)pool->freeList;
+    pool->freeList = index;
+    --pool->live;
+}
+
+void* handlePoolGet(HandlePool* pool, Handle handle)
+{
+    i64 index = (i64)(handle & K_HANDLE_INDEX_MASK);
+    u32 gen = handle >> K_HANDLE_INDEX_BITS;
+
+    if (index >= pool->count) return 0;
+    if (__handlePoolChunk(pool, index)->gens[index & (K_HANDLE_POOL_CHUNK - 1)] != (gen | K_HANDLE_LIVE)) return 0;
+    return handlePoolAt(pool, index);
+}
+
+i64 handlePoolIndexOf(HandlePool* pool, const void* elem)
+{
+    const u8* p = (const u8 *)elem;
+    arrayFor(pool->chunks)
+    {
+        const u8* data = pool->chunks[i] + __handlePoolDataOffset;
+        if (p >= data && p < data + K_HANDLE_POOL_CHUNK * pool->elemSize)
+        {
+            return (i64)i * K_HANDLE_POOL_CHUNK + (i64)(p - data) / pool->elemSize;
+        }
+    }
+    return -1;
+}
+
+i64 __handlePoolNext(HandlePool* pool, i64 index)
+{
+    // Scan 64 slots at a time, skipping the words with no live elements.
+    const i64 wordsPerChunk = K_HANDLE_POOL_CHUNK / 64;
+    i64 numWords = (pool->count + 63) / 64;
+    i64 w = index / 64;
+    if (w >= numWords) return -1;
+    u64 bits = ((HandlePoolChunk *)pool->chunks[w / wordsPerChunk])->occupied[w % wordsPerChunk];
+    bits &= ~(u64)0 << (index % 64);
+    while (!bits)
+    {
+        if (++w == numWords) return -1;
+        bits = ((HandlePoolChunk *)pool->chunks[w / wordsPerChunk])->occupied[w % wordsPerChunk];
+    }
+    return w * 64 + __poolFirstBit(bits);
+}
+
+Handle handlePoolHandleAt(HandlePool* pool, i64 index)
+{
+    u16 gen = __handlePoolChunk(pool, index)->gens[index & (K_HANDLE_POOL_CHUNK - 1)];
+    return ((Handle)(gen & K_HANDLE_GEN_MAX) << K_HANDLE_INDEX_BITS) | (Handle)index;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Concurrent pools
+//----------------------------------------------------------------------------------------------------------------------
+
+typedef struct
+{
+    i64     id;             // ID of the pool these indices belong to, 0 if unused.
+    i64     count;
+    u32     indices[K_POOL_MAGAZINE_SIZE];
+}
+PoolMagazine;
+
+internal K_THREAD_LOCAL PoolMagazine gPoolMagazines[K_POOL_MAGAZINE_COUNT];
+internal volatile i64 gPoolNextId = 0;
+
+#define __concurrentPoolLink(pool, index) \
+    (((volatile u32 *)(pool)->chunks[(index) / K_CONCURRENT_POOL_CHUNK])[(index) & (K_CONCURRENT_POOL_CHUNK - 1)])
+#define __concurrentPoolHead(tag, index) ((i64)(((u64)(tag) << 32) | (u64)(index)))
+
+void concurrentPoolInit(ConcurrentPool* pool, i64 elemSize)
+{
+    K_ASSERT(K_CONCURRENT_POOL_CHUNK >= K_POOL_MAGAZINE_SIZE);
+    memoryClear(pool, sizeof(*pool));
+    pool->elemSize = K_ROUND_UP(elemSize, sizeof(i64));
+    pool->chunks = (u8 **)K_ALLOC_CLEAR(sizeof(u8*) * K_CONCURRENT_POOL_MAX_CHUNKS);
+    pool->id = K_ATOMIC_ADD(&gPoolNextId, 1) + 1;
+}
+
+void concurrentPoolDone(ConcurrentPool* pool)
+{
+    // Forget this thread's indices so that its magazine can serve other pools.
+    for (int i = 0; i < K_POOL_MAGAZINE_COUNT; ++i)
+    {
+        if (gPoolMagazines[i].id == pool->id) gPoolMagazines[i].id = gPoolMagazines[i].count = 0;
+    }
+
+    i64 chunkBytes = __concurrentPoolDataOffset + K_CONCURRENT_POOL_CHUNK * pool->elemSize;
+    for (int i = 0; i < K_CONCURRENT_POOL_MAX_CHUNKS; ++i)
+    {
+        if (pool->chunks[i]) K_FREE(pool->chunks[i], chunkBytes);
+    }
+    K_FREE(pool->chunks, sizeof(u8*) * K_CONCURRENT_POOL_MAX_CHUNKS);
+    pool->chunks = 0;
+}
+
+// Make sure the chunk holding an index exists.  If two threads race to create it, the loser frees theirs.
+internal bool __concurrentPoolEnsureChunk(ConcurrentPool* pool, i64 index)
+{
+    u8* volatile* slot = (u8* volatile *)&pool->chunks[index / K_CONCURRENT_POOL_CHUNK];
+    if (K_ATOMIC_LOAD_PTR(slot)) return YES;
+
+    i64 chunkBytes = __concurrentPoolDataOffset + K_CONCURRENT_POOL_CHUNK * pool->elemSize;
+    u8* chunk = (u8 *)K_ALLOC(chunkBytes);
+    if (!chunk) return NO;
+    if (K_ATOMIC_CAS_PTR(slot, 0, chunk)) K_FREE(chunk, chunkBytes);
+    return YES;
+}
+
+// Push a batch of indices on to the shared free list with a single compare-and-swap.
+internal void __concurrentPoolPush(ConcurrentPool* pool, const u32* indices, i64 count)
+{
+    for (i64 i = 0; i < count - 1; ++i) __concurrentPoolLink(pool, indices[i]) = indices[i + 1] + 1;
+
+    for (;;)
+    {
+        i64 head = K_ATOMIC_LOAD(&pool->head);
+        __concurrentPoolLink(pool, indices[count - 1]) = (u32)head;
+        i64 newHead = __concurrentPoolHead(((u64)head >> 32) + 1, indices[0] + 1);
+        if (K_ATOMIC_CAS(&pool->head, head, newHead) == head) break;
+    }
+}
+
+// Pop an index from the shared free list, or return -1 if it is empty.
+internal i64 __concurrentPoolPop(ConcurrentPool* pool)
+{
+    for (;;)
+    {
+        i64 head = K_ATOMIC_LOAD(&pool->head);
+        u32 top = (u32)head;
+        if (!top) return -1;
+
+        // Another thread may pop this element and change its link before our compare-and-swap, but then the tag will
+        // have changed and we try again.
+        u32 next = __concurrentPoolLink(pool, top - 1);
+        i64 newHead = __concurrentPoolHead(((u64)head >> 32) + 1, next);
+        if (K_ATOMIC_CAS(&pool->head, head, newHead) == head) return (i64)top - 1;
+    }
+}
+
+// Find this thread's magazine for a pool, or take over one that holds no indices.  Returns 0 if every magazine holds
+// indices for other pools, and the caller then uses the shared list directly.
+internal PoolMagazine* __concurrentPoolMagazine(ConcurrentPool* pool)
+{
+    PoolMagazine* empty = 0;
+    for (int i = 0; i < K_POOL_MAGAZINE_COUNT; ++i)
+    {
+        if (gPoolMagazines[i].id == pool->id) return &gPoolMagazines[i];
+        if (!empty && !gPoolMagazines[i].count) empty = &gPoolMagazines[i];
+    }
+
+    if (empty) empty->id = pool->id;
+    return empty;
+}
+
+void* concurrentPoolAcquire(ConcurrentPool* pool, i64* outIndex)
+{
+    PoolMagazine* mag = __concurrentPoolMagazine(pool);
+
+    if (!mag)
+    {
+        i64 index = __concurrentPoolPop(pool);
+        if (index < 0)
+        {
+            index = K_ATOMIC_ADD(&pool->count, 1);
+            if (index >= (i64)K_CONCURRENT_POOL_CHUNK * K_CONCURRENT_POOL_MAX_CHUNKS) return 0;
+            if (!__concurrentPoolEnsureChunk(pool, index)) return 0;
+        }
+        if (outIndex) *outIndex = index;
+        return concurrentPoolAt(pool, index);
+    }
+
+    if (!mag->count)
+    {
+        // Refill half the magazine from the shared list, or failing that, from slots that have never been used.
+        i64 index;
+        while (mag->count < K_POOL_MAGAZINE_SIZE / 2 && (index = __concurrentPoolPop(pool)) >= 0)
+        {
+            mag->indices[mag->count++] = (u32)index;
+        }
+
+        if (!mag->count)
+        {
+            i64 maxCount = (i64)K_CONCURRENT_POOL_CHUNK * K_CONCURRENT_POOL_MAX_CHUNKS;
+            i64 start = K_ATOMIC_ADD(&pool->count, K_POOL_MAGAZINE_SIZE / 2);
+            i64 end = K_MIN(start + K_POOL_MAGAZINE_SIZE / 2, maxCount);
+            if (start >= end) return 0;
+            if (!__concurrentPoolEnsureChunk(pool, start) || !__concurrentPoolEnsureChunk(pool, end - 1)) return 0;
+
+            // Fill the magazine so that the lowest index is acquired first.
+            for (i64 i = end - 1; i >= start; --i) mag->indices[mag->count++] = (u32)i;
+        }
+    }
+
+    i64 index = mag->indices[--mag->count];
+    if (outIndex) *outIndex = index;
+    return concurrentPoolAt(pool, index);
+}
+
+void concurrentPoolRecycle(ConcurrentPool* pool, i64 index)
+{
+    PoolMagazine* mag = __concurrentPoolMagazine(pool);
+
+    if (!mag)
+    {
+        u32 i = (u32)index;
+        __concurrentPoolPush(pool, &i, 1);
+        return;
+    }
+
+    if (mag->count == K_POOL_MAGAZINE_SIZE)
+    {
+        // Hand the older half of the magazine to the other threads.
+        __concurrentPoolPush(pool, mag->indices, K_POOL_MAGAZINE_SIZE / 2);
+        memoryMove(mag->indices + K_POOL_MAGAZINE_SIZE / 2, mag->indices, sizeof(u32) * (K_POOL_MAGAZINE_SIZE / 2));
+        mag->count = K_POOL_MAGAZINE_SIZE / 2;
+    }
+
+    mag->indices[mag->count++] = (u32)index;
+}
+
+void concurrentPoolFlush(ConcurrentPool* pool)
+{
+    for (int i = 0; i < K_POOL_MAGAZINE_COUNT; ++i)
+    {
+        PoolMagazine* mag = &gPoolMagazines[i];
+        if (mag->id == pool->id)
+        {
+            if (mag->count) __concurrentPoolPush(pool, mag->indices, mag->count);
+            mag->id = 0;
+            mag->count = 0;
+        }
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------{DATA}
+//----------------------------------------------------------------------------------------------------------------------
+// Data API
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+
+Data dataLoad(const char* fileName)
+{
+    return dataLoadHint(fileName, DH_Normal);
+}
+
+Data dataMake(const char* fileName, i64 size)
+{
+    return dataMakeHint(fileName, size, DH_Normal);
+}
+
+#if K_OS_WIN32
+
+internal DWORD __dataFileFlags(u32 hints)
+{
+    DWORD flags = 0;
+    if (hints & DH_Sequential)  flags |= FILE_FLAG_SEQUENTIAL_SCAN;
+    if (hints & DH_Random)      flags |= FILE_FLAG_RANDOM_ACCESS;
+    return flags;
+}
+
+internal void __dataPrefetch(Data* b, u32 hints)
+{
+#if _WIN32_WINNT >= 0x0602
+    if (b->bytes && (hints & (DH_WillNeed | DH_Populate)))
+    {
+        WIN32_MEMORY_RANGE_ENTRY range = { b->bytes, (SIZE_T)b->size };
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+    }
+#endif
+}
+
+Data dataLoadHint(const char* fileName, u32 hints)
+{
+    Data b = { 0 };
+
+    b.file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, __dataFileFlags(hints), 0);
+    if (b.file != INVALID_HANDLE_VALUE)
+    {
+        DWORD fileSizeHigh, fileSizeLow;
+        fileSizeLow = GetFileSize(b.file, &fileSizeHigh);
+        b.fileMap = CreateFileMappingA(b.file, 0, PAGE_READONLY, fileSizeHigh, fileSizeLow, 0);
+
+        if (b.fileMap)
+        {
+            b.bytes = MapViewOfFile(b.fileMap, FILE_MAP_READ, 0, 0, 0);
+            b.size = ((i64)fileSizeHigh << 32) | fileSizeLow;
+            __dataPrefetch(&b, hints);
+        }
+        else
+        {
+            dataUnload(b);
+        }
+    }
+
+    return b;
+}
+
+void dataUnload(Data b)
+{
+    if (b.bytes)        UnmapViewOfFile(b.bytes);
+    if (b.fileMap)      CloseHandle(b.fileMap);
+    if (b.file)         CloseHandle(b.file);
+
+    b.bytes = 0;
+    b.size = 0;
+    b.file = INVALID_HANDLE_VALUE;
+    b.fileMap = INVALID_HANDLE_VALUE;
+}
+
+// Close a Data's handles but leave the bytes mapped.  The view keeps the file mapping alive until __dataUnmap.
+// Returns NO if the bytes are not a mapping.
+internal bool __dataDetach(Data* b)
+{
+    if (b->fileMap)     CloseHandle(b->fileMap);
+    if (b->file)        CloseHandle(b->file);
+
+    b->file = INVALID_HANDLE_VALUE;
+    b->fileMap = INVALID_HANDLE_VALUE;
+    return YES;
+}
+
+internal void __dataUnmap(void* bytes, i64 size)
+{
+    UnmapViewOfFile(bytes);
+}
+
+Data dataMakeHint(const char* fileName, i64 size, u32 hints)
+{
+    Data b = { 0 };
+
+    b.file = CreateFileA(fileName, GENERIC_READ | GENERIC_WRITE, 0, 0, CREATE_ALWAYS, __dataFileFlags(hints), 0);
+    if (b.file != INVALID_HANDLE_VALUE)
+    {
+        DWORD fileSizeLow = (size & 0xffffffff);
+        DWORD fileSizeHigh = (size >> 32);
+        b.fileMap = CreateFileMappingA(b.file, 0, PAGE_READWRITE, fileSizeHigh, fileSizeLow, 0);
+
+        if (b.fileMap)
+        {
+            b.bytes = MapViewOfFile(b.fileMap, FILE_MAP_WRITE, 0, 0, 0);
+            b.size = size;
+            __dataPrefetch(&b, hints);
+        }
+        else
+        {
+            dataUnload(b);
+        }
+    }
+
+    return b;
+}
+
+internal bool __dataWriterMap(DataWriter* w, i64 capacity)
+{
+    DWORD sizeLow = (capacity & 0xffffffff);
+    DWORD sizeHigh = (capacity >> 32);
+
+    // Mapping more than the file's size extends the file.
+    w->fileMap = CreateFileMappingA(w->file, 0, PAGE_READWRITE, sizeHigh, sizeLow, 0);
+    if (!w->fileMap) return NO;
+
+    w->bytes = MapViewOfFile(w->fileMap, FILE_MAP_WRITE, 0, 0, 0);
+    if (!w->bytes)
+    {
+        CloseHandle(w->fileMap);
+        w->fileMap = 0;
+        return NO;
+    }
+
+    w->capacity = capacity;
+    return YES;
+}
+
+internal void __dataWriterUnmap(DataWriter* w)
+{
+    if (w->bytes)       UnmapViewOfFile(w->bytes);
+    if (w->fileMap)     CloseHandle(w->fileMap);
+    w->bytes = 0;
+    w->fileMap = 0;
+}
+
+bool dataWriterOpen(DataWriter* w, const char* fileName, i64 initialSize)
+{
+    memoryClear(w, sizeof(DataWriter));
+    w->file = CreateFileA(fileName, GENERIC_READ | GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+    if (w->file == INVALID_HANDLE_VALUE) return NO;
+
+    if (!__dataWriterMap(w, K_MAX(initialSize, K_DATA_WRITER_MIN_SIZE)))
+    {
+        CloseHandle(w->file);
+        DeleteFileA(fileName);
+        return NO;
+    }
+
+    return YES;
+}
+
+internal bool __dataWriterGrow(DataWriter* w, i64 capacity)
+{
+    i64 oldCapacity = w->capacity;
+    __dataWriterUnmap(w);
+    return __dataWriterMap(w, capacity) || __dataWriterMap(w, oldCapacity);
+}
+
+void dataWriterFlush(DataWriter* w, bool wait)
+{
+    FlushViewOfFile(w->bytes, (SIZE_T)w->size);
+    if (wait) FlushFileBuffers(w->file);
+}
+
+bool dataWriterClose(DataWriter* w)
+{
+    LARGE_INTEGER size;
+    size.QuadPart = w->size;
+
+    __dataWriterUnmap(w);
+    bool result = K_BOOL(SetFilePointerEx(w->file, size, 0, FILE_BEGIN) && SetEndOfFile(w->file));
+    CloseHandle(w->file);
+    w->file = INVALID_HANDLE_VALUE;
+    return result;
+}
+
+internal bool __dataStreamOpen(DataStream* ds, const char* fileName)
+{
+    if (fileName)
+    {
+        ds->file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+        ds->closeFile = YES;
+    }
+    else
+    {
+        ds->file = GetStdHandle(STD_INPUT_HANDLE);
+        ds->closeFile = NO;
+    }
+
+    return K_BOOL(ds->file != INVALID_HANDLE_VALUE && ds->file != 0);
+}
+
+internal i64 __dataStreamRead(DataStream* ds, u8* buffer, i64 size)
+{
+    DWORD bytesRead = 0;
+    if (!ReadFile(ds->file, buffer, (DWORD)K_MIN(size, K_MB(1024)), &bytesRead, 0))
+    {
+        // A pipe whose writer has gone fails rather than returning 0 bytes.
+        return GetLastError() == ERROR_BROKEN_PIPE ? 0 : -1;
+    }
+
+    return (i64)bytesRead;
+}
+
+internal void __dataStreamClose(DataStream* ds)
+{
+    if (ds->closeFile) CloseHandle(ds->file);
+}
+
+#elif K_OS_LINUX
+
+internal void __dataAdvise(Data* b, u32 hints)
+{
+    if (hints & DH_Sequential)
+    {
+        // Double the file's readahead window as well as marking the pages.
+        posix_fadvise(b->file, 0, 0, POSIX_FADV_SEQUENTIAL);
+        madvise(b->bytes, (size_t)b->size, MADV_SEQUENTIAL);
+    }
+    if (hints & DH_Random)      madvise(b->bytes, (size_t)b->size, MADV_RANDOM);
+    if (hints & DH_WillNeed)    madvise(b->bytes, (size_t)b->size, MADV_WILLNEED);
+}
+
+internal int __dataMapFlags(int flags, u32 hints)
+{
+#ifdef MAP_POPULATE
+    if (hints & DH_Populate) flags |= MAP_POPULATE;
+#endif
+    return flags;
+}
+
+// Read the whole file into the heap with pread.  size is a guess at the file size, and can be 0.
+internal bool __dataRead(Data* b, i64 size)
+{
+    // One spare byte so that reading a file of exactly the expected size sees the end without growing.
+    i64 capacity = K_MAX(size + 1, K_KB(4));
+    u8* bytes = K_ALLOC(capacity);
+    i64 numBytes = 0;
+
+    for (;;)
+    {
+        if (numBytes == capacity)
+        {
+            bytes = K_REALLOC(bytes, capacity, capacity * 2);
+            capacity *= 2;
+        }
+
+        ssize_t n = pread(b->file, bytes + numBytes, (size_t)(capacity - numBytes), (off_t)numBytes);
+        if (n > 0)
+        {
+            numBytes += n;
+        }
+        else if (n == 0)
+        {
+            break;
+        }
+        else if (errno != EINTR)
+        {
+            numBytes = 0;
+            break;
+        }
+    }
+
+    if (numBytes == 0)
+    {
+        K_FREE(bytes, capacity);
+        return NO;
+    }
+
+    b->bytes = bytes;
+    b->size = numBytes;
+    b->capacity = capacity;
+    return YES;
+}
+
+Data dataLoadHint(const char* fileName, u32 hints)
+{
+    Data b = { 0 };
+    struct stat st;
+
+    b.file = open(fileName, O_RDONLY);
+    if (b.file != -1)
+    {
+        if (fstat(b.file, &st) == 0)
+        {
+            if (st.st_size > 0)
+            {
+                void* bytes = mmap(0, (size_t)st.st_size, PROT_READ, __dataMapFlags(MAP_PRIVATE, hints), b.file, 0);
+                if (bytes != MAP_FAILED)
+                {
+                    b.bytes = (u8 *)bytes;
+                    b.size = (i64)st.st_size;
+                    __dataAdvise(&b, hints);
+                    return b;
+                }
+            }
+
+            // Some files cannot be mapped, and some, like those in /proc, say they are empty when they are not.
+            if (S_ISREG(st.st_mode) && __dataRead(&b, (i64)st.st_size))
+            {
+                close(b.file);
+                b.file = -1;
+                return b;
+            }
+        }
+        dataUnload(b);
+        b.file = -1;
+    }
+
+    return b;
+}
+
+void dataUnload(Data b)
+{
+    if (b.capacity)     K_FREE(b.bytes, b.capacity);
+    else if (b.bytes)   munmap(b.bytes, (size_t)b.size);
+    if (b.file > 0)     close(b.file);
+}
+
+// Close a Data's file but leave the bytes mapped.  The mapping keeps the file alive until __dataUnmap.
+// Returns NO if the bytes were read into the heap rather than mapped.
+internal bool __dataDetach(Data* b)
+{
+    if (b->file > 0) close(b->file);
+    b->file = -1;
+    return K_BOOL(b->capacity == 0);
+}
+
+internal void __dataUnmap(void* bytes, i64 size)
+{
+    munmap(bytes, (size_t)size);
+}
+
+Data dataMakeHint(const char* fileName, i64 size, u32 hints)
+{
+    Data b = { 0 };
+
+    b.file = open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (b.file != -1)
+    {
+        if (ftruncate(b.file, (off_t)size) == 0)
+        {
+            void* bytes = mmap(0, (size_t)size, PROT_READ | PROT_WRITE, __dataMapFlags(MAP_SHARED, hints), b.file, 0);
+            if (bytes != MAP_FAILED)
+            {
+                b.bytes = (u8 *)bytes;
+                b.size = size;
+                __dataAdvise(&b, hints);
+                return b;
+            }
+        }
+        dataUnload(b);
+        b.file = -1;
+    }
+
+    return b;
+}
+
+bool dataWriterOpen(DataWriter* w, const char* fileName, i64 initialSize)
+{
+    i64 capacity = K_MAX(initialSize, K_DATA_WRITER_MIN_SIZE);
+
+    memoryClear(w, sizeof(DataWriter));
+    w->file = open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (w->file == -1) return NO;
+
+    if (ftruncate(w->file, (off_t)capacity) == 0)
+    {
+        void* bytes = mmap(0, (size_t)capacity, PROT_READ | PROT_WRITE, MAP_SHARED, w->file, 0);
+        if (bytes != MAP_FAILED)
+        {
+            w->bytes = (u8 *)bytes;
+            w->capacity = capacity;
+            return YES;
+        }
+    }
+
+    close(w->file);
+    unlink(fileName);
+    return NO;
+}
+
+internal bool __dataWriterGrow(DataWriter* w, i64 capacity)
+{
+    // If remapping fails, the file is left at the larger size until dataWriterClose truncates it.
+    if (ftruncate(w->file, (off_t)capacity) != 0) return NO;
+
+    void* bytes = (void *)syscall(SYS_mremap, w->bytes, (size_t)w->capacity, (size_t)capacity, MREMAP_MAYMOVE);
+    if (bytes == MAP_FAILED) return NO;
+
+    w->bytes = (u8 *)bytes;
+    w->capacity = capacity;
+    return YES;
+}
+
+void dataWriterFlush(DataWriter* w, bool wait)
+{
+    if (w->size > 0) msync(w->bytes, (size_t)w->size, wait ? MS_SYNC : MS_ASYNC);
+}
+
+bool dataWriterClose(DataWriter* w)
+{
+    if (w->bytes) munmap(w->bytes, (size_t)w->capacity);
+    bool result = K_BOOL(ftruncate(w->file, (off_t)w->size) == 0);
+    close(w->file);
+
+    w->bytes = 0;
+    w->capacity = 0;
+    w->file = -1;
+    return result;
+}
+
+internal bool __dataStreamOpen(DataStream* ds, const char* fileName)
+{
+    if (fileName)
+    {
+        ds->file = open(fileName, O_RDONLY);
+        ds->closeFile = YES;
+        if (ds->file != -1) posix_fadvise(ds->file, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+    else
+    {
+        ds->file = STDIN_FILENO;
+        ds->closeFile = NO;
+    }
+
+    return K_BOOL(ds->file != -1);
+}
+
+internal i64 __dataStreamRead(DataStream* ds, u8* buffer, i64 size)
+{
+    ssize_t n;
+    do
+    {
+        n = read(ds->file, buffer, (size_t)size);
+    }
+    while (n == -1 && errno == EINTR);
+
+    return (i64)n;
+}
+
+internal void __dataStreamClose(DataStream* ds)
+{
+    if (ds->closeFile) close(ds->file);
+}
+
+#else
+#   error Please implement for your platform
+#endif
+
+//----------------------------------------------------------------------------------------------------------------------
+// Data writers
+//----------------------------------------------------------------------------------------------------------------------
+
+u8* dataWriterAlloc(DataWriter* w, i64 numBytes)
+{
+    K_ASSERT(w->bytes, "Data writer is not open");
+    if (!w->bytes) return 0;
+
+    if (w->size + numBytes > w->capacity)
+    {
+        i64 capacity = w->capacity;
+        while (capacity < w->size + numBytes) capacity *= 2;
+        if (!__dataWriterGrow(w, capacity)) return 0;
+    }
+
+    u8* p = w->bytes + w->size;
+    w->size += numBytes;
+    return p;
+}
+
+bool dataWriterWrite(DataWriter* w, const void* data, i64 numBytes)
+{
+    u8* p = dataWriterAlloc(w, numBytes);
+    if (p) memoryCopy(data, p, numBytes);
+    return K_BOOL(p != 0);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Data streams
+//----------------------------------------------------------------------------------------------------------------------
+
+bool dataStreamOpen(DataStream* ds, const char* fileName, i64 chunkSize, i64 overlap)
+{
+    K_ASSERT(chunkSize > 0);
+    K_ASSERT(overlap >= 0);
+
+    memoryClear(ds, sizeof(DataStream));
+    if (!__dataStreamOpen(ds, fileName)) return NO;
+
+    ds->chunkSize = chunkSize;
+    ds->overlap = overlap;
+    ds->buffer = K_ALLOC(overlap + chunkSize);
+    ds->bytes = ds->buffer + overlap;
+    return YES;
+}
 
-void debugBreakOnAlloc(int n)
+bool dataStreamNext(DataStream* ds, i64 keep)
 {
-#ifdef _DEBUG
-    _crtBreakAlloc = n;
-#endif
+    if (ds->eof) return NO;
+
+    K_ASSERT(keep >= 0 && keep <= ds->overlap && keep <= ds->size);
+    keep = K_MAX(K_MIN(K_MIN(keep, ds->overlap), ds->size), 0);
+
+    // Move the kept bytes to just before the chunk.
+    u8* chunk = ds->buffer + ds->overlap;
+    memoryMove(ds->bytes + ds->size - keep, chunk - keep, keep);
+    ds->offset += ds->size - keep;
+
+    // Fill the whole chunk, so that only the last window is short.  Pipes can return less than was asked for.
+    i64 numBytes = 0;
+    while (numBytes < ds->chunkSize)
+    {
+        i64 n = __dataStreamRead(ds, chunk + numBytes, ds->chunkSize - numBytes);
+        if (n <= 0)
+        {
+            ds->eof = YES;
+            ds->error = K_BOOL(n < 0);
+            break;
+        }
+        numBytes += n;
+    }
+
+    // If the end came exactly on a chunk boundary, the kept bytes still need to be seen once more.
+    ds->bytes = chunk - keep;
+    ds->size = keep + numBytes;
+    return K_BOOL(ds->size > 0);
+}
+
+void dataStreamClose(DataStream* ds)
+{
+    __dataStreamClose(ds);
+    K_FREE(ds->buffer, ds->overlap + ds->chunkSize);
+    ds->buffer = 0;
+    ds->bytes = 0;
+    ds->size = 0;
 }
 
+//----------------------------------------------------------------------------------------------------------------------
+// Asynchronous loading
 //----------------------------------------------------------------------------------------------------------------------
 
-void pr(const char* format, ...)
+typedef struct
 {
-    va_list args;
-    va_start(args, format);
+    String      fileName;
+    Data        data;
+    bool        done;
+#if K_DATA_LOADER_URING
+    int         fd;
+    i64         offset;         // Bytes read so far into data.bytes, which is data.capacity bytes long.
+#endif
+}
+DataRequest;
 
-    prv(format, args);
+//
+// Thread pool
+//
 
-    va_end(args);
+typedef struct
+{
+    Queue(DataRequest*) jobs;
+    bool                quit;
+    int                 numThreads;
+#if K_OS_WIN32
+    CRITICAL_SECTION    lock;
+    CONDITION_VARIABLE  workReady;
+    CONDITION_VARIABLE  workDone;
+    HANDLE              threads[K_DATA_LOADER_THREADS];
+#else
+    pthread_mutex_t     lock;
+    pthread_cond_t      workReady;
+    pthread_cond_t      workDone;
+    pthread_t           threads[K_DATA_LOADER_THREADS];
+#endif
 }
+DataLoaderPool;
 
-//----------------------------------------------------------------------------------------------------------------------
+#if K_OS_WIN32
 
-void prn(const char* format, ...)
+internal void __dataPoolLock(DataLoaderPool* pool)
 {
-    va_list args;
-    va_start(args, format);
-    prnv(format, args);
-    va_end(args);
+    EnterCriticalSection(&pool->lock);
 }
 
-//----------------------------------------------------------------------------------------------------------------------
+internal void __dataPoolUnlock(DataLoaderPool* pool)
+{
+    LeaveCriticalSection(&pool->lock);
+}
 
-internal char gLogBuffer[1024];
+internal void __dataPoolWait(DataLoaderPool* pool, CONDITION_VARIABLE* cond)
+{
+    SleepConditionVariableCS(cond, &pool->lock, INFINITE);
+}
 
-void prv(const char* format, va_list args)
+internal void __dataPoolWake(CONDITION_VARIABLE* cond)
 {
-    vsnprintf(gLogBuffer, 1024, format, args);
-#if K_OS_WIN32
-    OutputDebugStringA(gLogBuffer);
+    WakeAllConditionVariable(cond);
+}
+
+#else
+
+internal void __dataPoolLock(DataLoaderPool* pool)
+{
+    pthread_mutex_lock(&pool->lock);
+}
+
+internal void __dataPoolUnlock(DataLoaderPool* pool)
+{
+    pthread_mutex_unlock(&pool->lock);
+}
+
+internal void __dataPoolWait(DataLoaderPool* pool, pthread_cond_t* cond)
+{
+    pthread_cond_wait(cond, &pool->lock);
+}
+
+internal void __dataPoolWake(pthread_cond_t* cond)
+{
+    pthread_cond_broadcast(cond);
+}
+
 #endif
-    printf("%s", gLogBuffer);
+
+internal void __dataPoolWork(DataLoaderPool* pool)
+{
+    __dataPoolLock(pool);
+    for (;;)
+    {
+        while (!pool->quit && queueCount(pool->jobs) == 0) __dataPoolWait(pool, &pool->workReady);
+        if (queueCount(pool->jobs) == 0) break;
+
+        DataRequest* r = queuePopFront(pool->jobs);
+        __dataPoolUnlock(pool);
+
+        Data data = dataLoadHint((const char *)r->fileName, DH_Sequential | DH_Populate);
+
+        __dataPoolLock(pool);
+        r->data = data;
+        r->done = YES;
+        __dataPoolWake(&pool->workDone);
+    }
+    __dataPoolUnlock(pool);
 }
 
-//----------------------------------------------------------------------------------------------------------------------
+#if K_OS_WIN32
+internal DWORD WINAPI __dataPoolThread(LPVOID param)
+{
+    __dataPoolWork((DataLoaderPool *)param);
+    return 0;
+}
+#else
+internal void* __dataPoolThread(void* param)
+{
+    __dataPoolWork((DataLoaderPool *)param);
+    return 0;
+}
+#endif
 
-void prnv(const char *format, va_list args)
+internal DataLoaderPool* __dataPoolInit()
 {
-    prv(format, args);
-    pr("\n");
+    DataLoaderPool* pool = K_ALLOC_CLEAR(sizeof(DataLoaderPool));
+
+#if K_OS_WIN32
+    InitializeCriticalSection(&pool->lock);
+    InitializeConditionVariable(&pool->workReady);
+    InitializeConditionVariable(&pool->workDone);
+    for (int i = 0; i < K_DATA_LOADER_THREADS; ++i)
+    {
+        pool->threads[pool->numThreads] = CreateThread(0, 0, &__dataPoolThread, pool, 0, 0);
+        if (pool->threads[pool->numThreads]) ++pool->numThreads;
+    }
+#else
+    pthread_mutex_init(&pool->lock, 0);
+    pthread_cond_init(&pool->workReady, 0);
+    pthread_cond_init(&pool->workDone, 0);
+    for (int i = 0; i < K_DATA_LOADER_THREADS; ++i)
+    {
+        if (pthread_create(&pool->threads[pool->numThreads], 0, &__dataPoolThread, pool) == 0) ++pool->numThreads;
+    }
+#endif
+
+    return pool;
 }
 
-//----------------------------------------------------------------------------------------------------------------------{TIME}
-//----------------------------------------------------------------------------------------------------------------------
-// Time Management
-//----------------------------------------------------------------------------------------------------------------------
-//----------------------------------------------------------------------------------------------------------------------
+internal void __dataPoolDone(DataLoaderPool* pool)
+{
+    __dataPoolLock(pool);
+    pool->quit = YES;
+    __dataPoolWake(&pool->workReady);
+    __dataPoolUnlock(pool);
 
+#if K_OS_WIN32
+    WaitForMultipleObjects((DWORD)pool->numThreads, pool->threads, TRUE, INFINITE);
+    for (int i = 0; i < pool->numThreads; ++i) CloseHandle(pool->threads[i]);
+    DeleteCriticalSection(&pool->lock);
+#else
+    for (int i = 0; i < pool->numThreads; ++i) pthread_join(pool->threads[i], 0);
+    pthread_cond_destroy(&pool->workDone);
+    pthread_cond_destroy(&pool->workReady);
+    pthread_mutex_destroy(&pool->lock);
+#endif
 
-// NOTES:
-//  Windows uses QueryPerformanceCounter
-//  POSIX uses clock_gettime
-//  MacOSX uses mach_get_time
+    queueDone(pool->jobs);
+    K_FREE(pool, sizeof(DataLoaderPool));
+}
+
+internal void __dataPoolLoad(DataLoaderPool* pool, DataRequest* r)
+{
+    if (pool->numThreads == 0)
+    {
+        r->data = dataLoadHint((const char *)r->fileName, DH_Sequential);
+        r->done = YES;
+        return;
+    }
+
+    __dataPoolLock(pool);
+    queuePushBack(pool->jobs, r);
+    __dataPoolWake(&pool->workReady);
+    __dataPoolUnlock(pool);
+}
+
+//
+// io_uring
 //
 
-#if K_OS_WIN32
+#if K_DATA_LOADER_URING
 
-TimePoint timeNow()
+typedef struct
 {
-    LARGE_INTEGER t;
-    QueryPerformanceCounter(&t);
-    return t;
+    int                     fd;
+    u32                     numEntries;
+    u32                     numInFlight;    // Reads queued in the ring or being done by the kernel.
+    u32                     numToSubmit;    // Reads queued in the ring but not yet submitted.
+    Queue(DataRequest*)     waiting;        // Reads waiting for room in the ring.
+    bool                    failed;         // io_uring_enter failed, so reads are done with pread instead.
+
+    u32*                    sqTail;
+    u32*                    sqMask;
+    u32*                    sqArray;
+    struct io_uring_sqe*    sqes;
+    u32*                    cqHead;
+    u32*                    cqTail;
+    u32*                    cqMask;
+    struct io_uring_cqe*    cqes;
+
+    u8*                     sqRing;
+    u8*                     cqRing;
+    i64                     sqRingSize;
+    i64                     cqRingSize;
+    i64                     sqesSize;
 }
+DataLoaderUring;
 
-TimePeriod timePeriod(TimePoint a, TimePoint b)
+internal void __dataUringDone(DataLoaderUring* u)
 {
-    LARGE_INTEGER t;
-    t.QuadPart = b.QuadPart - a.QuadPart;
-    return t;
+    if (u->sqes)                                        munmap(u->sqes, (size_t)u->sqesSize);
+    if (u->cqRing && u->cqRing != u->sqRing)            munmap(u->cqRing, (size_t)u->cqRingSize);
+    if (u->sqRing)                                      munmap(u->sqRing, (size_t)u->sqRingSize);
+    if (u->fd >= 0)                                     close(u->fd);
+
+    queueDone(u->waiting);
+    K_FREE(u, sizeof(DataLoaderUring));
 }
 
-TimePoint timeFuture(TimePoint t, TimePeriod p)
+// Returns 0 if io_uring is unavailable or too old to have IORING_OP_READ (Linux 5.6).
+internal DataLoaderUring* __dataUringInit()
 {
-    t.QuadPart += p.QuadPart;
-    return t;
+    struct io_uring_params params;
+    memoryClear(&params, sizeof(params));
+
+    DataLoaderUring* u = K_ALLOC_CLEAR(sizeof(DataLoaderUring));
+    u->fd = (int)syscall(__NR_io_uring_setup, K_DATA_LOADER_DEPTH, &params);
+    if (u->fd < 0)
+    {
+        __dataUringDone(u);
+        return 0;
+    }
+
+    i64 probeSize = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe* probe = K_ALLOC_CLEAR(probeSize);
+    bool canRead = K_BOOL(syscall(__NR_io_uring_register, u->fd, IORING_REGISTER_PROBE, probe, 256) == 0 &&
+                          probe->ops_len > IORING_OP_READ &&
+                          (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED));
+    K_FREE(probe, probeSize);
+
+    u->numEntries = params.sq_entries;
+    u->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(u32);
+    u->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    u->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        u->sqRingSize = u->cqRingSize = K_MAX(u->sqRingSize, u->cqRingSize);
+    }
+
+    void* sq = canRead
+        ? mmap(0, (size_t)u->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQ_RING)
+        : MAP_FAILED;
+    u->sqRing = sq == MAP_FAILED ? 0 : sq;
+
+    void* cq = (!u->sqRing || (params.features & IORING_FEAT_SINGLE_MMAP))
+        ? sq
+        : mmap(0, (size_t)u->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_CQ_RING);
+    u->cqRing = cq == MAP_FAILED ? 0 : cq;
+
+    void* sqes = u->cqRing
+        ? mmap(0, (size_t)u->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQES)
+        : MAP_FAILED;
+    u->sqes = sqes == MAP_FAILED ? 0 : sqes;
+
+    if (!u->sqes)
+    {
+        __dataUringDone(u);
+        return 0;
+    }
+
+    u->sqTail = (u32 *)(u->sqRing + params.sq_off.tail);
+    u->sqMask = (u32 *)(u->sqRing + params.sq_off.ring_mask);
+    u->sqArray = (u32 *)(u->sqRing + params.sq_off.array);
+    u->cqHead = (u32 *)(u->cqRing + params.cq_off.head);
+    u->cqTail = (u32 *)(u->cqRing + params.cq_off.tail);
+    u->cqMask = (u32 *)(u->cqRing + params.cq_off.ring_mask);
+    u->cqes = (struct io_uring_cqe *)(u->cqRing + params.cq_off.cqes);
+    return u;
 }
 
-TimePeriod timeSecs(f64 time)
+internal void __dataUringReadSync(DataRequest* r);
+
+// Queue a read of the rest of the file.
+internal void __dataUringRead(DataLoaderUring* u, DataRequest* r)
 {
-    LARGE_INTEGER t;
-    LARGE_INTEGER freq;
-    QueryPerformanceFrequency(&freq);
-    t.QuadPart = (LONGLONG)(time * (f64)freq.QuadPart);
-    return t;
+    if (u->failed)
+    {
+        __dataUringReadSync(r);
+        return;
+    }
+
+    if (u->numInFlight == u->numEntries)
+    {
+        queuePushBack(u->waiting, r);
+        return;
+    }
+
+    // Only this thread writes the tail, so it can be read without an atomic.
+    u32 tail = *u->sqTail;
+    u32 index = tail & *u->sqMask;
+    struct io_uring_sqe* sqe = &u->sqes[index];
+
+    memoryClear(sqe, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = r->fd;
+    sqe->addr = (u64)(uintptr_t)(r->data.bytes + r->offset);
+    sqe->len = (u32)K_MIN(r->data.capacity - r->offset, K_MB(1024));
+    sqe->off = (u64)r->offset;
+    sqe->user_data = (u64)(uintptr_t)r;
+    u->sqArray[index] = index;
+    __atomic_store_n(u->sqTail, tail + 1, __ATOMIC_RELEASE);
+
+    ++u->numInFlight;
+    ++u->numToSubmit;
+}
+
+internal void __dataUringFinish(DataRequest* r, bool failed)
+{
+    close(r->fd);
+    if (failed || r->offset == 0)
+    {
+        K_FREE(r->data.bytes, r->data.capacity);
+        r->data.bytes = 0;
+        r->data.capacity = 0;
+    }
+    else
+    {
+        r->data.size = r->offset;
+    }
+    r->done = YES;
+}
+
+internal void __dataUringComplete(DataLoaderUring* u, DataRequest* r, i32 result)
+{
+    if (result == -EINTR || result == -EAGAIN)
+    {
+        __dataUringRead(u, r);
+        return;
+    }
+
+    if (result > 0)
+    {
+        r->offset += result;
+        if (r->offset < r->data.capacity)
+        {
+            // Short read, so ask for the rest.
+            __dataUringRead(u, r);
+            return;
+        }
+    }
+
+    // Either everything has been read, the file got shorter, or there was an error.
+    __dataUringFinish(r, K_BOOL(result < 0));
+}
+
+// Read the rest of the file with pread.
+internal void __dataUringReadSync(DataRequest* r)
+{
+    bool failed = NO;
+    while (r->offset < r->data.capacity)
+    {
+        ssize_t n = pread(r->fd, r->data.bytes + r->offset, (size_t)(r->data.capacity - r->offset), (off_t)r->offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0)
+        {
+            failed = K_BOOL(n < 0);
+            break;
+        }
+        r->offset += n;
+    }
+
+    __dataUringFinish(r, failed);
+}
+
+// Stop using the ring after io_uring_enter fails for good.  Reads that the kernel hasn't seen are taken back out of the
+// ring and done with pread, along with those waiting for room.  Reads already submitted still complete into the ring.
+internal void __dataUringFail(DataLoaderUring* u)
+{
+    u->failed = YES;
+
+    u32 tail = *u->sqTail;
+    for (u32 i = 0; i < u->numToSubmit; ++i)
+    {
+        struct io_uring_sqe* sqe = &u->sqes[(tail - 1 - i) & *u->sqMask];
+        queuePushBack(u->waiting, (DataRequest *)(uintptr_t)sqe->user_data);
+    }
+    __atomic_store_n(u->sqTail, tail - u->numToSubmit, __ATOMIC_RELEASE);
+    u->numInFlight -= u->numToSubmit;
+    u->numToSubmit = 0;
+
+    while (queueCount(u->waiting) > 0) __dataUringReadSync(queuePopFront(u->waiting));
+}
+
+// Submit queued reads and handle any completions.  If wait is YES, blocks until at least one read completes.
+internal void __dataUringPump(DataLoaderUring* u, bool wait)
+{
+    while (queueCount(u->waiting) > 0 && u->numInFlight < u->numEntries)
+    {
+        __dataUringRead(u, queuePopFront(u->waiting));
+    }
+
+    u32 minComplete = (wait && u->numInFlight > 0) ? 1 : 0;
+    if (!u->failed && (u->numToSubmit > 0 || minComplete > 0))
+    {
+        long submitted = syscall(__NR_io_uring_enter, u->fd, u->numToSubmit, minComplete,
+                                 minComplete ? IORING_ENTER_GETEVENTS : 0, 0, 0);
+        if (submitted > 0)
+        {
+            u->numToSubmit -= (u32)submitted;
+        }
+        else if (submitted < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+        {
+            __dataUringFail(u);
+        }
+    }
+
+    u32 head = *u->cqHead;
+    u32 tail = __atomic_load_n(u->cqTail, __ATOMIC_ACQUIRE);
+    if (u->failed && minComplete > 0 && head == tail)
+    {
+        // Without io_uring_enter, all we can do is poll for the submitted reads to complete.
+        __timeSleep(0.001);
+        tail = __atomic_load_n(u->cqTail, __ATOMIC_ACQUIRE);
+    }
+    for (; head != tail; ++head)
+    {
+        struct io_uring_cqe* cqe = &u->cqes[head & *u->cqMask];
+        DataRequest* r = (DataRequest *)(uintptr_t)cqe->user_data;
+        i32 result = cqe->res;
+
+        // Free the completion slot before handling it, as that might queue another read.
+        __atomic_store_n(u->cqHead, head + 1, __ATOMIC_RELEASE);
+        --u->numInFlight;
+        __dataUringComplete(u, r, result);
+    }
+}
+
+// Returns NO if the file should just be loaded synchronously.
+internal bool __dataUringLoad(DataLoaderUring* u, DataRequest* r)
+{
+    struct stat st;
+
+    if (u->failed) return NO;
+
+    r->fd = open((const char *)r->fileName, O_RDONLY);
+    if (r->fd == -1) return NO;
+
+    if (fstat(r->fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0)
+    {
+        close(r->fd);
+        return NO;
+    }
+
+    posix_fadvise(r->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    r->data.bytes = K_ALLOC(st.st_size);
+    r->data.capacity = (i64)st.st_size;
+    r->data.file = -1;
+    r->offset = 0;
+    __dataUringRead(u, r);
+
+    if (u->numToSubmit >= K_DATA_LOADER_BATCH) __dataUringPump(u, NO);
+    return YES;
+}
+
+#endif // K_DATA_LOADER_URING
+
+//
+// API
+//
+
+void dataLoaderInit(DataLoader* L)
+{
+    handlePoolInit(&L->requests, sizeof(DataRequest));
+    L->uring = NO;
+    L->impl = 0;
+
+#if K_DATA_LOADER_URING
+    L->impl = __dataUringInit();
+    L->uring = K_BOOL(L->impl != 0);
+#endif
+
+    if (!L->impl) L->impl = __dataPoolInit();
+}
+
+void dataLoaderDone(DataLoader* L)
+{
+    Array(Handle) handles = 0;
+    handlePoolFor(&L->requests)
+    {
+        arrayAdd(handles, handlePoolHandleAt(&L->requests, i));
+    }
+    for (i64 i = 0; i < arrayCount(handles); ++i)
+    {
+        Data data;
+        dataWaitAny(L, &handles[i], 1, &data);
+        dataUnload(data);
+    }
+    arrayDone(handles);
+
+#if K_DATA_LOADER_URING
+    if (L->uring) __dataUringDone((DataLoaderUring *)L->impl);
+    else
+#endif
+    __dataPoolDone((DataLoaderPool *)L->impl);
+
+    handlePoolDone(&L->requests);
+    L->impl = 0;
+}
+
+Handle dataLoadAsync(DataLoader* L, const char* fileName)
+{
+    Handle h;
+    DataRequest* r = handlePoolAcquire(&L->requests, &h);
+    memoryClear(r, sizeof(DataRequest));
+    r->fileName = stringMake((const i8 *)fileName);
+
+#if K_DATA_LOADER_URING
+    if (L->uring)
+    {
+        if (!__dataUringLoad((DataLoaderUring *)L->impl, r))
+        {
+            r->data = dataLoad(fileName);
+            r->done = YES;
+        }
+    }
+    else
+#endif
+    __dataPoolLoad((DataLoaderPool *)L->impl, r);
+
+    return h;
 }
 
-TimePeriod timeMsecs(i64 ms)
+// Returns the index of a completed or invalid handle, or -1 if none have completed.  With threads, hold the pool lock.
+internal i64 __dataFindDone(DataLoader* L, const Handle* handles, i64 count)
 {
-    LARGE_INTEGER t;
-    LARGE_INTEGER freq;
-    QueryPerformanceFrequency(&freq);
-    t.QuadPart = (LONGLONG)(ms * freq.QuadPart / 1000);
-    return t;
+    for (i64 i = 0; i < count; ++i)
+    {
+        DataRequest* r = handlePoolGet(&L->requests, handles[i]);
+        K_ASSERT(r, "Invalid or already completed data handle");
+        if (!r || r->done) return i;
+    }
+
+    return -1;
 }
 
-i64 timeToMSecs(TimePeriod period)
+i64 dataWaitAny(DataLoader* L, const Handle* handles, i64 count, Data* data)
 {
-    LARGE_INTEGER freq;
-    QueryPerformanceFrequency(&freq);
-    return period.QuadPart * 1000 / freq.QuadPart;
+    if (count <= 0) return -1;
+
+    i64 index;
+#if K_DATA_LOADER_URING
+    if (L->uring)
+    {
+        while ((index = __dataFindDone(L, handles, count)) < 0) __dataUringPump((DataLoaderUring *)L->impl, YES);
+    }
+    else
+#endif
+    {
+        DataLoaderPool* pool = (DataLoaderPool *)L->impl;
+        __dataPoolLock(pool);
+        while ((index = __dataFindDone(L, handles, count)) < 0) __dataPoolWait(pool, &pool->workDone);
+        __dataPoolUnlock(pool);
+    }
+
+    DataRequest* r = handlePoolGet(&L->requests, handles[index]);
+    memoryClear(data, sizeof(Data));
+    if (r)
+    {
+        *data = r->data;
+        stringDone(&r->fileName);
+        handlePoolRecycle(&L->requests, handles[index]);
+    }
+
+    return index;
 }
 
-f64 timeToSecs(TimePeriod period)
+void dataWaitAll(DataLoader* L, const Handle* handles, i64 count, Data* data)
 {
-    LARGE_INTEGER freq;
-    QueryPerformanceFrequency(&freq);
-    return (f64)period.QuadPart / (f64)freq.QuadPart;
+    for (i64 i = 0; i < count; ++i) dataWaitAny(L, &handles[i], 1, &data[i]);
 }
 
-void timeWaitFor(TimePeriod time)
+//----------------------------------------------------------------------------------------------------------------------
+// Arena images
+//----------------------------------------------------------------------------------------------------------------------
+
+bool arenaSave(Arena* arena, const char* fileName)
 {
-    TimePoint futureTime = timeFuture(timeNow(), time);
-    timeWaitUntil(futureTime);
+    ArenaBlock* block = 0;
+    i64 size = arena->cursor;
+
+    K_ASSERT(arena->type != AT_Concurrent, "Concurrent arenas cannot be saved");
+    if (arena->type == AT_Concurrent) return NO;
+
+    if (arena->type == AT_Chained)
+    {
+        // Block bases are offsets from the beginning of the chain, so writing each block out in full lays it out in the
+        // image exactly as offsets expect.
+        block = K_ARENA_BLOCK(arena);
+        size += block->base;
+        while (block->prev) block = block->prev;
+    }
+
+    Data d = dataMake(fileName, sizeof(ArenaImageHeader) + size);
+    if (!d.bytes) return NO;
+
+    ArenaImageHeader* hdr = (ArenaImageHeader *)d.bytes;
+    u8* dst = (u8 *)(hdr + 1);
+    memoryClear(hdr, sizeof(ArenaImageHeader));
+    hdr->magic = K_ARENA_IMAGE_MAGIC;
+    hdr->version = K_ARENA_IMAGE_VERSION;
+    hdr->size = size;
+
+    if (block)
+    {
+        for (; (u8 *)(block + 1) != arena->start; block = block->next)
+        {
+            memoryCopy(block + 1, dst + block->base, block->size);
+        }
+        memoryCopy(arena->start, dst + block->base, arena->cursor);
+    }
+    else
+    {
+        memoryCopy(arena->start, dst, size);
+    }
+    hdr->crc = crc32(dst, size);
+
+    dataUnload(d);
+    return YES;
 }
 
-void timeWaitUntil(TimePoint time)
+bool arenaMap(Arena* arena, const char* fileName)
 {
-    TimePeriod t = { 0 };
-    while ((t = timeNow()).QuadPart < time.QuadPart);
+    Data d = dataLoad(fileName);
+    ArenaImageHeader* hdr = (ArenaImageHeader *)d.bytes;
+
+    if (!hdr ||
+        d.size < (i64)sizeof(ArenaImageHeader) ||
+        hdr->magic != K_ARENA_IMAGE_MAGIC ||
+        hdr->version != K_ARENA_IMAGE_VERSION ||
+        hdr->size < 0 ||
+        hdr->size > d.size - (i64)sizeof(ArenaImageHeader) ||
+        hdr->crc != crc32(hdr + 1, hdr->size))
+    {
+        dataUnload(d);
+        return NO;
+    }
+
+    if (!__dataDetach(&d))
+    {
+        // The file was read rather than mapped, so its bytes cannot become the arena.
+        dataUnload(d);
+        return NO;
+    }
+
+    arena->start = (u8 *)(hdr + 1);
+    arena->end = arena->start + hdr->size;
+    arena->cursor = hdr->size;
+    arena->restore = -1;
+    arena->type = AT_Mapped;
+    arena->limit = d.bytes + d.size;
+    arena->highWater = 0;
+    arena->align = K_ARENA_ALIGN;
+    arena->hugePages = NO;
+    arena->id = 0;
+    return YES;
 }
 
-TimePeriod timeAdd(TimePeriod a, TimePeriod b)
+//----------------------------------------------------------------------------------------------------------------------{HASH}
+//----------------------------------------------------------------------------------------------------------------------
+// Hashing
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+
+u64 hash(const u8* buffer, i64 len)
 {
-    LARGE_INTEGER t;
-    t.QuadPart = a.QuadPart + b.QuadPart;
-    return t;
+    u64 h = 14695981039346656037ULL;
+    for (i64 i = 0; i < len; ++i)
+    {
+        h ^= *buffer++;
+        h *= (u64)1099511628211ull;
+    }
+
+    return h;
 }
 
-int timeCompare(TimePeriod a, TimePeriod b)
+u64 hashString(const i8* str)
 {
-    if (a.QuadPart < b.QuadPart)
+    u64 h = 14695981039346656037ULL;
+    while (*str != 0)
     {
-        return -1;
+        h ^= *str++;
+        h *= (u64)1099511628211ull;
     }
-    else if (a.QuadPart > b.QuadPart)
+
+    return h;
+}
+
+//----------------------------------------------------------------------------------------------------------------------{QUEUE}
+//----------------------------------------------------------------------------------------------------------------------
+// Queues
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+
+#define K_QUEUE_MIN_CAPACITY 16
+
+void* __queueInternalGrow(void* q, i64 elemSize)
+{
+    i64 capacity = q ? 2 * __queueCapacity(q) : K_QUEUE_MIN_CAPACITY;
+    i64* p = (i64 *)K_ALLOC(elemSize * capacity + sizeof(i64) * 4);
+    if (p)
     {
-        return 1;
+        p[0] = capacity;
+        p[1] = 0;
+        p[2] = 0;
+        p[3] = 0;
+        if (q)
+        {
+            // Unwrap the elements to the start of the new buffer.
+            p[2] = __queueInternalDrain(q, p + 4, __queueCount(q), elemSize);
+            K_FREE(__queueRaw(q), elemSize * __queueCapacity(q) + sizeof(i64) * 4);
+        }
+        return p + 4;
     }
     else
     {
@@ -951,429 +5383,622 @@ int timeCompare(TimePeriod a, TimePeriod b)
     }
 }
 
-#else
-#   error Implement for your platform
-#endif
+i64 __queueInternalDrain(void* q, void* dst, i64 n, i64 elemSize)
+{
+    i64 count = K_MIN(n, __queueCount(q));
+    i64 head = __queueHead(q);
+    i64 first = K_MIN(count, __queueCapacity(q) - head);
 
-//----------------------------------------------------------------------------------------------------------------------{ENTRY}
+    // The elements may wrap around the end of the buffer, so copy in up to two pieces.
+    memoryCopy((u8 *)q + head * elemSize, dst, first * elemSize);
+    memoryCopy(q, (u8 *)dst + first * elemSize, (count - first) * elemSize);
+    __queueHead(q) = __queueIndex(q, count);
+    __queueCount(q) -= count;
+    return count;
+}
+
+//----------------------------------------------------------------------------------------------------------------------{HASHMAP}
 //----------------------------------------------------------------------------------------------------------------------
-// Entry point
+// Hash maps
 //----------------------------------------------------------------------------------------------------------------------
 //----------------------------------------------------------------------------------------------------------------------
 
-extern int kmain(int argc, char** argv);
+#define __hashMapEntry(hdr, m, i) ((u8 *)(m) + (i) * (hdr)->entrySize)
 
-internal const char* gExePath = 0;
+internal i64 __hashMapBytes(i64 capacity, i64 entrySize)
+{
+    return (i64)sizeof(HashMapHeader) + (capacity + 1) * entrySize + capacity + K_HASHMAP_GROUP;
+}
 
-int main(int argc, char** argv)
+internal u64 __hashMapHash(HashMapHeader* hdr, const void* key)
 {
-#if K_DEBUG
-    _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
-#endif
+    return hdr->hashFunc ? hdr->hashFunc(key, hdr->keySize) : hash((const u8 *)key, hdr->keySize);
+}
 
-#if K_OS_WIN32
-    _get_pgmptr((char **)&gExePath);
+internal void __hashMapSetCtrl(HashMapHeader* hdr, u8* ctrl, i64 slot, u8 value)
+{
+    ctrl[slot] = value;
+    if (slot < K_HASHMAP_GROUP) ctrl[hdr->capacity + slot] = value;
+}
+
+internal int __hashMapFirstBit(u32 mask)
+{
+#if K_COMPILER_MSVC
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (int)index;
 #else
-#   error Implement executable path query for your OS.
+    return __builtin_ctz(mask);
 #endif
-    return kmain(argc, argv);
 }
 
-#if K_OS_WIN32
-int WINAPI WinMain(HINSTANCE inst, HINSTANCE prevInst, LPSTR cmdLine, int cmdShow)
+// Return a bit mask of the control bytes in the group starting at ctrl that equal value.
+internal u32 __hashMapMatch(const u8* ctrl, u8 value)
 {
-#if K_DEBUG
-    _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
+#if K_CPU_X86 || K_CPU_X64
+    __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+    return (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)value)));
+#else
+    u32 mask = 0;
+    for (int i = 0; i < K_HASHMAP_GROUP; ++i) if (ctrl[i] == value) mask |= 1u << i;
+    return mask;
 #endif
-
-    gExePath = __argv[0];
-
-    int result = kmain(__argc, __argv);
-    return result;
 }
-#endif
 
-//----------------------------------------------------------------------------------------------------------------------{MEMORY}
-//----------------------------------------------------------------------------------------------------------------------
-// Memory
-//----------------------------------------------------------------------------------------------------------------------
-//----------------------------------------------------------------------------------------------------------------------
+// Return a bit mask of the empty slots in the group starting at ctrl.
+internal u32 __hashMapMatchEmpty(const u8* ctrl)
+{
+#if K_CPU_X86 || K_CPU_X64
+    return (u32)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)ctrl));
+#else
+    u32 mask = 0;
+    for (int i = 0; i < K_HASHMAP_GROUP; ++i) if (ctrl[i] & K_HASHMAP_EMPTY) mask |= 1u << i;
+    return mask;
+#endif
+}
 
-internal void* memoryOp(void* oldAddress, i64 oldNumBytes, i64 newNumBytes, const char* file, int line)
+// Look for the staged key.  Returns its slot, or -(slot + 1) where slot is the empty slot it would be inserted into.
+internal i64 __hashMapProbe(void* m)
 {
-    void* p = 0;
+    HashMapHeader* hdr = __hashMapRaw(m);
+    u8* ctrl = __hashMapCtrl(m);
+    u8* key = __hashMapEntry(hdr, m, hdr->capacity);
+    u64 h = __hashMapHash(hdr, key);
+    u8 h2 = (u8)(h >> 57);
+    i64 mask = hdr->capacity - 1;
+    i64 pos = (i64)h & mask;
 
-    if (newNumBytes)
+    for (;;)
     {
-        p = realloc(oldAddress, newNumBytes);
+        u32 match = __hashMapMatch(ctrl + pos, h2);
+        u32 empty = __hashMapMatchEmpty(ctrl + pos);
+
+        // Keys can't live beyond the first empty slot on their probe sequence.
+        if (empty) match &= (1u << __hashMapFirstBit(empty)) - 1;
+        while (match)
+        {
+            i64 slot = (pos + __hashMapFirstBit(match)) & mask;
+            if (memoryCompare(__hashMapEntry(hdr, m, slot), key, hdr->keySize) == 0) return slot;
+            match &= match - 1;
+        }
+
+        if (empty) return -(((pos + __hashMapFirstBit(empty)) & mask) + 1);
+        pos = (pos + K_HASHMAP_GROUP) & mask;
     }
-    else
+}
+
+void* __hashMapInternalReserve(void* m, i64 n, i64 entrySize, i64 keySize, HashFunc hashFunc)
+{
+    HashMapHeader* old = m ? __hashMapRaw(m) : 0;
+    i64 capacity = K_HASHMAP_GROUP;
+    HashMapHeader* hdr = 0;
+    void* newMap = 0;
+
+    while (capacity * 7 < n * 8) capacity *= 2;
+    if (old && capacity <= old->capacity) return m;
+
+    hdr = (HashMapHeader *)K_ALLOC(__hashMapBytes(capacity, entrySize));
+    if (!hdr) return 0;
+    memoryClear(hdr, sizeof(HashMapHeader));
+    hdr->capacity = capacity;
+    hdr->entrySize = entrySize;
+    hdr->keySize = keySize;
+    hdr->hashFunc = old ? old->hashFunc : hashFunc;
+    newMap = hdr + 1;
+    memset(__hashMapCtrl(newMap), K_HASHMAP_EMPTY, (size_t)(capacity + K_HASHMAP_GROUP));
+
+    if (old)
     {
-        free(oldAddress);
+        // Rehash all the entries into the new table.
+        u8* ctrl = __hashMapCtrl(m);
+        for (i64 i = 0; i < old->capacity; ++i)
+        {
+            if (ctrl[i] & K_HASHMAP_EMPTY) continue;
+            memoryCopy(__hashMapEntry(old, m, i), __hashMapEntry(hdr, newMap, capacity), keySize);
+            i64 slot = -__hashMapProbe(newMap) - 1;
+            memoryCopy(__hashMapEntry(old, m, i), __hashMapEntry(hdr, newMap, slot), entrySize);
+            __hashMapSetCtrl(hdr, __hashMapCtrl(newMap), slot, ctrl[i]);
+        }
+        hdr->count = old->count;
+        __hashMapInternalDone(m);
     }
 
-    return p;
+    return newMap;
 }
 
-void* memoryAlloc(i64 numBytes, const char* file, int line)
+void __hashMapInternalDone(void* m)
 {
-    return memoryOp(0, 0, numBytes, file, line);
+    HashMapHeader* hdr = __hashMapRaw(m);
+    K_FREE(hdr, __hashMapBytes(hdr->capacity, hdr->entrySize));
 }
 
-void* memoryAllocClear(i64 numBytes, const char* file, int line)
+i64 __hashMapInternalInsert(void* m)
 {
-    void* p = memoryOp(0, 0, numBytes, file, line);
-    memoryClear(p, numBytes);
-    return p;
-}
+    HashMapHeader* hdr = __hashMapRaw(m);
+    i64 slot = __hashMapProbe(m);
 
-void* memoryRealloc(void* address, i64 oldNumBytes, i64 newNumBytes, const char* file, int line)
-{
-    return memoryOp(address, oldNumBytes, newNumBytes, file, line);
+    if (slot < 0)
+    {
+        u8* key = __hashMapEntry(hdr, m, hdr->capacity);
+        slot = -slot - 1;
+        memoryCopy(key, __hashMapEntry(hdr, m, slot), hdr->keySize);
+        __hashMapSetCtrl(hdr, __hashMapCtrl(m), slot, (u8)(__hashMapHash(hdr, key) >> 57));
+        ++hdr->count;
+    }
+
+    hdr->last = slot;
+    return slot;
 }
 
-void memoryFree(void* address, i64 numBytes, const char* file, int line)
+i64 __hashMapInternalFind(void* m)
 {
-    memoryOp(address, numBytes, 0, file, line);
+    HashMapHeader* hdr = __hashMapRaw(m);
+    i64 slot = __hashMapProbe(m);
+    hdr->last = slot;
+    return slot;
 }
 
-void memoryCopy(const void* src, void* dst, i64 numBytes)
+bool __hashMapInternalDelete(void* m)
 {
-    memcpy(dst, src, (size_t)numBytes);
+    HashMapHeader* hdr = __hashMapRaw(m);
+    u8* ctrl = __hashMapCtrl(m);
+    i64 mask = hdr->capacity - 1;
+    i64 hole = __hashMapProbe(m);
+    i64 i = hole;
+
+    if (hole < 0) return NO;
+
+    // Shift back any following entries that can legally fill the hole, so that no tombstone is needed.
+    for (;;)
+    {
+        i = (i + 1) & mask;
+        if (ctrl[i] & K_HASHMAP_EMPTY) break;
+
+        i64 home = (i64)__hashMapHash(hdr, __hashMapEntry(hdr, m, i)) & mask;
+        bool homeInRange = hole <= i ? (hole < home && home <= i) : (hole < home || home <= i);
+        if (!homeInRange)
+        {
+            memoryCopy(__hashMapEntry(hdr, m, i), __hashMapEntry(hdr, m, hole), hdr->entrySize);
+            __hashMapSetCtrl(hdr, ctrl, hole, ctrl[i]);
+            hole = i;
+        }
+    }
+
+    __hashMapSetCtrl(hdr, ctrl, hole, K_HASHMAP_EMPTY);
+    --hdr->count;
+    return YES;
 }
 
-void memoryMove(const void* src, void* dst, i64 numBytes)
+void __hashMapInternalClear(void* m)
 {
-    memmove(dst, src, (size_t)numBytes);
+    HashMapHeader* hdr = __hashMapRaw(m);
+    memset(__hashMapCtrl(m), K_HASHMAP_EMPTY, (size_t)(hdr->capacity + K_HASHMAP_GROUP));
+    hdr->count = 0;
 }
 
-int memoryCompare(const void* mem1, const void* mem2, i64 numBytes)
+//----------------------------------------------------------------------------------------------------------------------{SORT}
+//----------------------------------------------------------------------------------------------------------------------
+// Sorting
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+
+#define K_SORT_INSERTION_MAX    16
+#define K_RADIX_BITS            11
+#define K_RADIX_BUCKETS         (1 << K_RADIX_BITS)
+#define K_RADIX_PASSES          ((64 + K_RADIX_BITS - 1) / K_RADIX_BITS)
+
+internal void __sortSwap(u8* a, u8* b, i64 size)
 {
-    return memcmp(mem1, mem2, (size_t)numBytes);
+    while (size >= 8)
+    {
+        u64 t;
+        memcpy(&t, a, 8);
+        memcpy(a, b, 8);
+        memcpy(b, &t, 8);
+        a += 8;
+        b += 8;
+        size -= 8;
+    }
+    while (size--)
+    {
+        u8 t = *a;
+        *a++ = *b;
+        *b++ = t;
+    }
 }
 
-void memoryClear(void* mem, i64 numBytes)
+internal void __sortInsertion(u8* base, i64 count, i64 size, SortCompareFunc cmp)
 {
-    memset(mem, 0, (size_t)numBytes);
+    for (i64 i = 1; i < count; ++i)
+    {
+        for (u8* p = base + i * size; p > base && cmp(p - size, p) > 0; p -= size)
+        {
+            __sortSwap(p - size, p, size);
+        }
+    }
 }
 
-//----------------------------------------------------------------------------------------------------------------------
-// Arena control
-//----------------------------------------------------------------------------------------------------------------------
-
-void arenaInit(Arena* arena, i64 initialSize)
+internal void __sortSiftDown(u8* base, i64 root, i64 count, i64 size, SortCompareFunc cmp)
 {
-    u8* buffer = (u8 *)malloc(initialSize);
-    if (buffer)
+    for (;;)
     {
-        arena->start = buffer;
-        arena->end = arena->start + initialSize;
-        arena->cursor = 0;
-        arena->restore = -1;
+        i64 child = 2 * root + 1;
+        if (child >= count) break;
+        if (child + 1 < count && cmp(base + child * size, base + (child + 1) * size) < 0) ++child;
+        if (cmp(base + root * size, base + child * size) >= 0) break;
+        __sortSwap(base + root * size, base + child * size, size);
+        root = child;
     }
 }
 
-void arenaDone(Arena* arena)
+internal void __sortHeap(u8* base, i64 count, i64 size, SortCompareFunc cmp)
 {
-    free(arena->start);
-    arena->start = 0;
-    arena->end = 0;
-    arena->cursor = 0;
-    arena->restore = -1;
+    for (i64 i = count / 2 - 1; i >= 0; --i) __sortSiftDown(base, i, count, size, cmp);
+    for (i64 i = count - 1; i > 0; --i)
+    {
+        __sortSwap(base, base + i * size, size);
+        __sortSiftDown(base, 0, i, size, cmp);
+    }
 }
 
-void* arenaAlloc(Arena* arena, i64 size)
+internal void __sortIntro(u8* base, i64 count, i64 size, SortCompareFunc cmp, int depth)
 {
-    void* p = 0;
-    if ((arena->start + arena->cursor + size) > arena->end)
+    while (count > K_SORT_INSERTION_MAX)
     {
-        // We don't have enough room
-        i64 currentSize = (i64)(arena->end - (u8 *)arena->start);
-        i64 requiredSize = currentSize + size;
-        i64 newSize = currentSize + K_MAX(requiredSize, K_ARENA_INCREMENT);
+        if (depth-- == 0)
+        {
+            // Too many bad pivots, so guarantee O(n log n).
+            __sortHeap(base, count, size, cmp);
+            return;
+        }
 
-        u8* newArena = (u8 *)realloc(arena->start, newSize);
+        // Median of three.  The pivot ends up at the start, and the last element is no less than the pivot, which
+        // bounds the scans below.
+        u8* lo = base;
+        u8* mid = base + (count / 2) * size;
+        u8* hi = base + (count - 1) * size;
+        if (cmp(mid, lo) < 0) __sortSwap(mid, lo, size);
+        if (cmp(hi, mid) < 0)
+        {
+            __sortSwap(hi, mid, size);
+            if (cmp(mid, lo) < 0) __sortSwap(mid, lo, size);
+        }
+        __sortSwap(lo, mid, size);
 
-        if (newArena)
+        i64 i = 1;
+        i64 j = count - 1;
+        for (;;)
         {
-            arena->start = newArena;
-            arena->end = newArena + newSize;
+            while (cmp(base + i * size, base) < 0) ++i;
+            while (cmp(base, base + j * size) < 0) --j;
+            if (i >= j) break;
+            __sortSwap(base + i * size, base + j * size, size);
+            ++i;
+            --j;
+        }
+        __sortSwap(base, base + j * size, size);
 
-            // Try again!
-            p = arenaAlloc(arena, size);
+        // Recurse into the smaller side to bound the stack depth.
+        if (j < count - j - 1)
+        {
+            __sortIntro(base, j, size, cmp, depth);
+            base += (j + 1) * size;
+            count -= j + 1;
+        }
+        else
+        {
+            __sortIntro(base + (j + 1) * size, count - j - 1, size, cmp, depth);
+            count = j;
         }
     }
-    else
-    {
-        p = arena->start + arena->cursor;
-        arena->cursor += size;
-    }
 
-    return p;
+    __sortInsertion(base, count, size, cmp);
+}
+
+void sortInPlace(void* base, i64 count, i64 elemSize, SortCompareFunc cmp)
+{
+    int depth = 0;
+    for (i64 n = count; n > 1; n >>= 1) depth += 2;
+    __sortIntro((u8 *)base, count, elemSize, cmp, depth);
+}
+
+//
+// Radix sort
+//
+
+typedef struct
+{
+    u64     key;
+    i64     index;
 }
+RadixItem;
 
-void* arenaAlign(Arena* arena)
+internal u64 __radixKey(const void* elem, i64 size)
 {
-    i64 mod = arena->cursor % K_ARENA_ALIGN;
-    void* p = arena->start + arena->cursor;
-
-    if (mod)
+    switch (size)
     {
-        // We need to align
-        arenaAlloc(arena, K_ARENA_ALIGN - mod);
+    case 1: return *(const u8 *)elem;
+    case 2: return *(const u16 *)elem;
+    case 4: return *(const u32 *)elem;
+    default: return *(const u64 *)elem;
     }
-
-    return p;
 }
 
-void* arenaAlignedAlloc(Arena* arena, i64 numBytes)
+u64 radixKeyI32(const void* elem)
 {
-    arenaAlign(arena);
-    return arenaAlloc(arena, numBytes);
+    return (u64)(*(const u32 *)elem ^ 0x80000000u);
 }
 
-void arenaPush(Arena* arena)
+u64 radixKeyI64(const void* elem)
 {
-    arenaAlign(arena);
-    {
-        i64* p = arenaAlloc(arena, sizeof(i64) * 2);
-        p[0] = 0xaaaaaaaaaaaaaaaa;
-        p[1] = arena->restore;
-        arena->restore = (i64)((u8 *)p - arena->start);
-    }
+    return *(const u64 *)elem ^ 0x8000000000000000ull;
 }
 
-void arenaPop(Arena* arena)
+u64 radixKeyF32(const void* elem)
 {
-    i64* p = 0;
-    K_ASSERT(arena->restore != -1, "Make sure we have some restore points left");
-    arena->cursor = arena->restore;
-    p = (i64 *)(arena->start + arena->cursor);
-    p[0] = 0xbbbbbbbbbbbbbbbb;
-    arena->restore = p[1];
+    // Flip all the bits of negative numbers and just the sign bit of positive ones.
+    u32 bits = *(const u32 *)elem;
+    return (u64)(bits ^ ((bits & 0x80000000u) ? 0xffffffffu : 0x80000000u));
 }
 
-i64 arenaSpace(Arena* arena)
+u64 radixKeyF64(const void* elem)
 {
-    return (arena->end - arena->start) - arena->cursor;
+    u64 bits = *(const u64 *)elem;
+    return bits ^ ((bits & 0x8000000000000000ull) ? 0xffffffffffffffffull : 0x8000000000000000ull);
 }
 
-char* arenaFormatV(Arena* arena, const char* format, va_list args)
+void sortRadix(void* base, i64 count, i64 elemSize, RadixKeyFunc key)
 {
-    i64 c = arena->cursor;
-    i64 maxSize = arenaSpace(arena);
-    char* p = 0;
+    K_ASSERT(key || elemSize == 1 || elemSize == 2 || elemSize == 4 || elemSize == 8, "Need a key function");
+    if (count < 2) return;
 
-    int numChars = vsnprintf(arena->start + arena->cursor, maxSize, format, args);
-    if (numChars < maxSize)
+    RadixItem* items = (RadixItem *)K_ALLOC(sizeof(RadixItem) * count * 2);
+    u8* elems = (u8 *)K_ALLOC(elemSize * count);
+    i64* counts = (i64 *)K_ALLOC_CLEAR(sizeof(i64) * K_RADIX_BUCKETS * K_RADIX_PASSES);
+    RadixItem* src = items;
+    RadixItem* dst = items + count;
+    u8* b = (u8 *)base;
+
+    // Extract the keys and build the histograms for every digit in one pass.
+    for (i64 i = 0; i < count; ++i)
     {
-        // The string fit in the space left.
-        p = (char *)arenaAlloc(arena, numChars + 1);
+        u64 k = key ? key(b + i * elemSize) : __radixKey(b + i * elemSize, elemSize);
+        src[i].key = k;
+        src[i].index = i;
+        for (int pass = 0; pass < K_RADIX_PASSES; ++pass)
+        {
+            ++counts[pass * K_RADIX_BUCKETS + ((k >> (pass * K_RADIX_BITS)) & (K_RADIX_BUCKETS - 1))];
+        }
     }
-    else
+
+    for (int pass = 0; pass < K_RADIX_PASSES; ++pass)
     {
-        // There wasn't enough room to hold the string.  Allocate more and try again.
-        char* p = (char *)arenaAlloc(arena, numChars + 1);
-        numChars = vsnprintf(p, numChars + 1, format, args);
+        i64* c = counts + pass * K_RADIX_BUCKETS;
+        int shift = pass * K_RADIX_BITS;
+
+        // Skip the pass if every key has the same digit.
+        if (c[(src[0].key >> shift) & (K_RADIX_BUCKETS - 1)] == count) continue;
+
+        i64 total = 0;
+        for (int d = 0; d < K_RADIX_BUCKETS; ++d)
+        {
+            i64 n = c[d];
+            c[d] = total;
+            total += n;
+        }
+        for (i64 i = 0; i < count; ++i)
+        {
+            dst[c[(src[i].key >> shift) & (K_RADIX_BUCKETS - 1)]++] = src[i];
+        }
+
+        RadixItem* t = src;
+        src = dst;
+        dst = t;
     }
 
-    return p;
+    // Move the elements into their sorted positions.
+    for (i64 i = 0; i < count; ++i) memoryCopy(b + src[i].index * elemSize, elems + i * elemSize, elemSize);
+    memoryCopy(elems, b, elemSize * count);
+
+    K_FREE(counts, sizeof(i64) * K_RADIX_BUCKETS * K_RADIX_PASSES);
+    K_FREE(elems, elemSize * count);
+    K_FREE(items, sizeof(RadixItem) * count * 2);
 }
 
-char* arenaFormat(Arena* arena, const char* format, ...)
+//
+// Parallel sort
+//
+
+typedef struct
 {
-    va_list(args);
-    va_start(args, format);
-    char* p = arenaFormatV(arena, format, args);
-    va_end(args);
-    return p;
+    u8*                 src;        // Sort: the range.  Merge: the two runs.
+    u8*                 dst;        // Merge: destination.
+    i64                 count;      // Sort: number of elements.  Merge: number in the first run.
+    i64                 count2;     // Merge: number in the second run.
+    i64                 size;
+    SortCompareFunc     cmp;
 }
+SortJob;
 
-//----------------------------------------------------------------------------------------------------------------------{ARRAY}
-//----------------------------------------------------------------------------------------------------------------------
-// Arrays
-//----------------------------------------------------------------------------------------------------------------------
-//----------------------------------------------------------------------------------------------------------------------
-
-void* __arrayInternalGrow(void* a, i64 increment, i64 elemSize)
+internal void __sortRunJob(SortJob* job)
 {
-    i64 doubleCurrent = a ? 2 * __arrayCapacity(a) : 0;
-    i64 minNeeded = arrayCount(a) + increment;
-    i64 capacity = doubleCurrent > minNeeded ? doubleCurrent : minNeeded;
-    i64 oldBytes = a ? elemSize * arrayCount(a) + sizeof(i64) * 2 : 0;
-    i64 bytes = elemSize * capacity + sizeof(i64) * 2;
-    i64* p = (i64 *)K_REALLOC(a ? __arrayRaw(a) : 0, oldBytes, bytes);
-    if (p)
+    if (!job->dst)
     {
-        if (!a) p[1] = 0;
-        p[0] = capacity;
-        return p + 2;
+        sortInPlace(job->src, job->count, job->size, job->cmp);
     }
     else
     {
-        return 0;
-    }
-}
-
-//----------------------------------------------------------------------------------------------------------------------{POOL}
-//----------------------------------------------------------------------------------------------------------------------
-// Pools
-//----------------------------------------------------------------------------------------------------------------------
-//----------------------------------------------------------------------------------------------------------------------
+        u8* a = job->src;
+        u8* aEnd = a + job->count * job->size;
+        u8* b = aEnd;
+        u8* bEnd = b + job->count2 * job->size;
+        u8* d = job->dst;
 
-void* __poolInternalAcquire(void* p, i64 increment, i64 elemSize, void** outP)
-{
-    // Test for capacity
-    // If this assert triggers, the element size is too small for a pool.
-    K_ASSERT(elemSize >= sizeof(i64));
-    if (!p || (__poolFreeList(p) == __poolCapacity(p)))
-    {
-        // We have no more room
-        i64 oldCapacity = p ? __poolCapacity(p) : 0;
-        i64 doubleCurrent = 2 * oldCapacity;
-        i64 minNeeded = (p ? __poolCapacity(p) : 0) + 1;
-        i64 capacity = doubleCurrent > minNeeded ? doubleCurrent : minNeeded;
-        i64 oldBytes = p ? elemSize * __poolCapacity(p) + sizeof(i64) * 2 : 0;
-        i64 bytes = elemSize * capacity + sizeof(i64) * 2;
-        i64* newP = (i64 *)K_REALLOC(p ? __poolRaw(p) : 0, oldBytes, bytes);
-        if (newP)
+        while (a < aEnd && b < bEnd)
         {
-            newP[0] = capacity;
-            if (!p) newP[1] = 0;
-            u8* b = (u8 *)(newP + 2);
-            for (i64 i = oldCapacity; i < capacity; ++i)
+            if (job->cmp(b, a) < 0)
             {
-                *(i64 *)(&b[i * elemSize]) = i + 1;
+                memoryCopy(b, d, job->size);
+                b += job->size;
             }
+            else
+            {
+                memoryCopy(a, d, job->size);
+                a += job->size;
+            }
+            d += job->size;
         }
-        else
-        {
-            return 0;
-        }
-
-        p = newP + 2;
+        memoryCopy(a, d, (i64)(aEnd - a));
+        d += aEnd - a;
+        memoryCopy(b, d, (i64)(bEnd - b));
     }
-
-    // Do the acquiring
-    u8* b = (u8 *)p;
-    i64 newIndex = __poolFreeList(p);
-    i64* b64 = (i64 *)&b[newIndex * elemSize];
-    __poolFreeList(p) = *b64;
-    *b64 = -1;
-    *outP = p;
-    return b64;
 }
 
-void __poolInternalRecycle(void* p, i64 index, i64 elemSize)
+#if K_OS_WIN32
+internal DWORD WINAPI __sortThread(LPVOID param)
 {
-    u8* b = (u8 *)p;
-    i64* b64 = (i64 *)&b[index * elemSize];
-    *b64 = __poolFreeList(p);
-    __poolFreeList(p) = index;
+    __sortRunJob((SortJob *)param);
+    return 0;
 }
-
-//----------------------------------------------------------------------------------------------------------------------{DATA}
-//----------------------------------------------------------------------------------------------------------------------
-// Data API
-//----------------------------------------------------------------------------------------------------------------------
-//----------------------------------------------------------------------------------------------------------------------
-
-#if K_OS_WIN32
-
-Data dataLoad(const char* fileName)
+#else
+internal void* __sortThread(void* param)
 {
-    Data b = { 0 };
+    __sortRunJob((SortJob *)param);
+    return 0;
+}
+#endif
 
-    b.file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, 0, 0);
-    if (b.file != INVALID_HANDLE_VALUE)
+// Run the jobs on their own threads, using this thread for the last one.
+internal void __sortRunJobs(SortJob* jobs, int numJobs)
+{
+#if K_OS_WIN32
+    HANDLE threads[K_SORT_MAX_THREADS];
+    for (int i = 0; i < numJobs - 1; ++i) threads[i] = CreateThread(0, 0, &__sortThread, &jobs[i], 0, 0);
+    __sortRunJob(&jobs[numJobs - 1]);
+    for (int i = 0; i < numJobs - 1; ++i)
     {
-        DWORD fileSizeHigh, fileSizeLow;
-        fileSizeLow = GetFileSize(b.file, &fileSizeHigh);
-        b.fileMap = CreateFileMappingA(b.file, 0, PAGE_READONLY, fileSizeHigh, fileSizeLow, 0);
-
-        if (b.fileMap)
+        if (threads[i])
         {
-            b.bytes = MapViewOfFile(b.fileMap, FILE_MAP_READ, 0, 0, 0);
-            b.size = ((i64)fileSizeHigh << 32) | fileSizeLow;
+            WaitForSingleObject(threads[i], INFINITE);
+            CloseHandle(threads[i]);
         }
         else
         {
-            dataUnload(b);
+            __sortRunJob(&jobs[i]);
         }
     }
-
-    return b;
-}
-
-void dataUnload(Data b)
-{
-    if (b.bytes)        UnmapViewOfFile(b.bytes);
-    if (b.fileMap)      CloseHandle(b.fileMap);
-    if (b.file)         CloseHandle(b.file);
-
-    b.bytes = 0;
-    b.size = 0;
-    b.file = INVALID_HANDLE_VALUE;
-    b.fileMap = INVALID_HANDLE_VALUE;
-}
-
-Data dataMake(const char* fileName, i64 size)
-{
-    Data b = { 0 };
-
-    b.file = CreateFileA(fileName, GENERIC_READ | GENERIC_WRITE, 0, 0, CREATE_ALWAYS, 0, 0);
-    if (b.file != INVALID_HANDLE_VALUE)
+#else
+    pthread_t threads[K_SORT_MAX_THREADS];
+    bool started[K_SORT_MAX_THREADS];
+    for (int i = 0; i < numJobs - 1; ++i) started[i] = pthread_create(&threads[i], 0, &__sortThread, &jobs[i]) == 0;
+    __sortRunJob(&jobs[numJobs - 1]);
+    for (int i = 0; i < numJobs - 1; ++i)
     {
-        DWORD fileSizeLow = (size & 0xffffffff);
-        DWORD fileSizeHigh = (size >> 32);
-        b.fileMap = CreateFileMappingA(b.file, 0, PAGE_READWRITE, fileSizeHigh, fileSizeLow, 0);
-
-        if (b.fileMap)
+        if (started[i])
         {
-            b.bytes = MapViewOfFile(b.fileMap, FILE_MAP_WRITE, 0, 0, 0);
-            b.size = size;
+            pthread_join(threads[i], 0);
         }
         else
         {
-            dataUnload(b);
+            __sortRunJob(&jobs[i]);
         }
     }
-
-    return b;
+#endif
 }
 
+internal int __sortNumThreads()
+{
+#if K_OS_WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    int n = (int)info.dwNumberOfProcessors;
 #else
-#   error Please implement for your platform
+    int n = (int)sysconf(_SC_NPROCESSORS_ONLN);
 #endif
+    return K_MAX(1, K_MIN(n, K_SORT_MAX_THREADS));
+}
 
-//----------------------------------------------------------------------------------------------------------------------{HASH}
-//----------------------------------------------------------------------------------------------------------------------
-// Hashing
-//----------------------------------------------------------------------------------------------------------------------
-//----------------------------------------------------------------------------------------------------------------------
-
-u64 hash(const u8* buffer, i64 len)
+void sortParallel(void* base, i64 count, i64 elemSize, SortCompareFunc cmp)
 {
-    u64 h = 14695981039346656037;
-    for (i64 i = 0; i < len; ++i)
+    int numRuns = __sortNumThreads();
+    if (count < K_SORT_PARALLEL_MIN || numRuns < 2)
     {
-        h ^= *buffer++;
-        h *= (u64)1099511628211ull;
+        sortInPlace(base, count, elemSize, cmp);
+        return;
     }
 
-    return h;
-}
+    u8* temp = (u8 *)K_ALLOC(elemSize * count);
+    if (!temp)
+    {
+        sortInPlace(base, count, elemSize, cmp);
+        return;
+    }
 
-u64 hashString(const i8* str)
-{
-    u64 h = 14695981039346656037;
-    while (*str != 0)
+    SortJob jobs[K_SORT_MAX_THREADS];
+    i64 starts[K_SORT_MAX_THREADS + 1];
+    u8* src = (u8 *)base;
+    u8* dst = temp;
+
+    // Sort the runs.
+    for (int i = 0; i <= numRuns; ++i) starts[i] = count * i / numRuns;
+    for (int i = 0; i < numRuns; ++i)
     {
-        h ^= *str++;
-        h *= (u64)1099511628211ull;
+        jobs[i].src = src + starts[i] * elemSize;
+        jobs[i].dst = 0;
+        jobs[i].count = starts[i + 1] - starts[i];
+        jobs[i].count2 = 0;
+        jobs[i].size = elemSize;
+        jobs[i].cmp = cmp;
     }
+    __sortRunJobs(jobs, numRuns);
 
-    return h;
+    // Merge pairs of runs until there is one left, ping-ponging between the array and the temporary buffer.
+    while (numRuns > 1)
+    {
+        int numJobs = 0;
+        for (int i = 0; i < numRuns; i += 2)
+        {
+            SortJob* job = &jobs[numJobs++];
+            i64 end2 = (i + 1 < numRuns) ? starts[i + 2] : starts[i + 1];
+            job->src = src + starts[i] * elemSize;
+            job->dst = dst + starts[i] * elemSize;
+            job->count = starts[i + 1] - starts[i];
+            job->count2 = end2 - starts[i + 1];
+            job->size = elemSize;
+            job->cmp = cmp;
+            starts[i / 2] = starts[i];
+        }
+        starts[numJobs] = count;
+        __sortRunJobs(jobs, numJobs);
+        numRuns = numJobs;
+
+        u8* t = src;
+        src = dst;
+        dst = t;
+    }
+
+    if (src != (u8 *)base) memoryCopy(src, base, elemSize * count);
+    K_FREE(temp, elemSize * count);
 }
 
 //----------------------------------------------------------------------------------------------------------------------{STRING}
@@ -1569,7 +6194,10 @@ u64 stringHash(String str)
 
 String stringFormatV(const i8* format, va_list args)
 {
-    int numChars = vsnprintf(0, 0, format, args);
+    va_list argsCopy;
+    va_copy(argsCopy, args);
+    int numChars = vsnprintf(0, 0, format, argsCopy);
+    va_end(argsCopy);
     StringHeader* hdr = stringAlloc(numChars);
     vsnprintf(hdr->str, numChars + 1, format, args);
     hdr->hash = hashString(hdr->str);
@@ -1623,7 +6251,6 @@ String stringGrow(String str1, String str2)
     if (hdr)
     {
         memoryCopy(str2, hdr->str + l1, l2);
-        hdr->size += l2;
         hdr->hash = hash(hdr->str, l1 + l2);
     }
 
@@ -1641,7 +6268,6 @@ String stringGrowCStr(String str1, const i8* str2)
     if (hdr)
     {
         memoryCopy(str2, hdr->str + l1, l2);
-        hdr->size += l2;
         hdr->hash = hash(hdr->str, l1 + l2);
     }
 
@@ -1696,7 +6322,10 @@ String arenaStringCopyRange(Arena* arena, const i8* str, const i8* end)
 
 String arenaStringFormatV(Arena* arena, const i8* format, va_list args)
 {
-    int numChars = vsnprintf(0, 0, format, args);
+    va_list argsCopy;
+    va_copy(argsCopy, args);
+    int numChars = vsnprintf(0, 0, format, argsCopy);
+    va_end(argsCopy);
     i8* buffer = (i8 *)arenaAlignedAlloc(arena, sizeof(StringHeader) + numChars + 1);
     StringHeader* hdr = (StringHeader*)buffer;
 
@@ -1783,7 +6412,7 @@ internal StringToken __stringTableAdd(StringTable* table, const i8* str, i64 str
                 if (memoryCompare(str, hdr->hdr.str, strLen) == 0)
                 {
                     // Found it!
-                    return hdr->hdr.str - table->start;
+                    return (u8 *)hdr->hdr.str - table->start;
                 }
             }
         }
@@ -1793,9 +6422,13 @@ internal StringToken __stringTableAdd(StringTable* table, const i8* str, i64 str
 
     // The string has not be found - create a new entry
     {
+        // Growing the arena can move it, so remember where the link is as an offset.
+        i64 blockOffset = (u8 *)blockPtr - b;
         StringTableHeader* hdr = arenaAlignedAlloc(table, sizeof(StringTableHeader) + strLen + 1);
 
         if (!hdr) return 0;
+        b = (u8 *)table->start;
+        blockPtr = (i64 *)&b[blockOffset];
 
         hdr->nextBlock = 0;
 
@@ -1809,13 +6442,16 @@ internal StringToken __stringTableAdd(StringTable* table, const i8* str, i64 str
 
         *blockPtr = (u8 *)hdr - b;
 
-        return hdr->hdr.str - table->start;
+        return (u8 *)hdr->hdr.str - table->start;
     }
 }
 
 StringToken stringTableAdd(StringTable* table, const i8* str)
 {
-    return __stringTableAdd(table, str, (i64)strlen(str));
+    K_TRACE_BEGIN("stringTableAdd");
+    StringToken token = __stringTableAdd(table, str, (i64)strlen(str));
+    K_TRACE_END();
+    return token;
 }
 
 StringToken stringTableAddRange(StringTable* table, const i8* str, const i8* end)
@@ -1924,8 +6560,7 @@ int stringCompareStringRange(const i8* s1, const i8* s2, const i8* s3)
 
 void randomInit(Random* R)
 {
-    __time64_t t = _time64(&t);
-    randomInitSeed(R, t);
+    randomInitSeed(R, (u64)time(0));
 }
 
 void randomInitSeed(Random* R, u64 seed)
@@ -2152,6 +6787,13 @@ void sha1ProcessData(Sha1* s, Data data)
     sha1ProcessBuffer(s, data.bytes, data.size);
 }
 
+void sha1ProcessStream(Sha1* s, DataStream* ds)
+{
+    sha1Init(s);
+    while (dataStreamNext(ds, 0)) sha1Add(s, ds->bytes, ds->size);
+    sha1Finalise(s);
+}
+
 internal void __sha1Transform(Sha1* s, const u8* buffer)
 {
     u32 a, b, c, d, e;
@@ -2263,6 +6905,7 @@ internal void __sha1Transform(Sha1* s, const u8* buffer)
 void sha1Add(Sha1* s, const void* data, i64 numBytes)
 {
     K_ASSERT(!s->finalised);
+    K_TRACE_BEGIN("sha1Add");
 
     u32 i, j = s->count[0];
 
@@ -2276,7 +6919,7 @@ void sha1Add(Sha1* s, const void* data, i64 numBytes)
     {
         memoryCopy(data, &s->buffer[j], (i = 64 - j));
         __sha1Transform(s, s->buffer);
-        for (; i + 64 < numBytes; i += 64)
+        for (; i + 63 < numBytes; i += 64)
         {
             __sha1Transform(s, &((const unsigned char *)data)[i]);
         }
@@ -2287,6 +6930,7 @@ void sha1Add(Sha1* s, const void* data, i64 numBytes)
         i = 0;
     }
     memoryCopy(&((const unsigned char *)data)[i], &s->buffer[j], numBytes - i);
+    K_TRACE_END();
 }
 
 void sha1Finalise(Sha1* s)
@@ -2348,7 +6992,7 @@ bool sha1Equal(Sha1* s1, Sha1* s2)
         if (s1->digest[i] != s2->digest[i]) return NO;
     }
 
-    return FALSE;
+    return YES;
 }
 
 //----------------------------------------------------------------------------------------------------------------------{SPAWN}
@@ -2357,6 +7001,8 @@ bool sha1Equal(Sha1* s1, Sha1* s2)
 //----------------------------------------------------------------------------------------------------------------------
 //----------------------------------------------------------------------------------------------------------------------
 
+#if K_OS_WIN32
+
 bool processStartAndWait(const i8* fileName, int argc, const i8** argv)
 {
     bool result = NO;
@@ -2399,7 +7045,6 @@ bool processStartAndWait(const i8* fileName, int argc, const i8** argv)
     }
     *s = 0;
 
-#if K_OS_WIN32
     {
         PROCESS_INFORMATION process;
         STARTUPINFO si;
@@ -2420,9 +7065,6 @@ bool processStartAndWait(const i8* fileName, int argc, const i8** argv)
             err = err;
         }
     }
-#else
-#   error Implement processStartAndWait for you OS.
-#endif
 
     K_FREE(args, argsSize + 1);
     K_FREE(hasSpaces, sizeof(bool) * argc);
@@ -2430,6 +7072,36 @@ bool processStartAndWait(const i8* fileName, int argc, const i8** argv)
     return result;
 }
 
+#elif K_OS_LINUX
+
+extern char** environ;
+
+bool processStartAndWait(const i8* fileName, int argc, const i8** argv)
+{
+    bool result = NO;
+    pid_t pid;
+    int status;
+
+    // posix_spawnp needs the file name as the first argument and a null terminator.
+    char** args = K_ALLOC(sizeof(char*) * (argc + 2));
+    args[0] = (char *)fileName;
+    for (int i = 0; i < argc; ++i) args[i + 1] = (char *)argv[i];
+    args[argc + 1] = 0;
+
+    if (posix_spawnp(&pid, (const char *)fileName, 0, 0, args, environ) == 0)
+    {
+        while (waitpid(pid, &status, 0) == -1 && errno == EINTR);
+        result = YES;
+    }
+
+    K_FREE(args, sizeof(char*) * (argc + 2));
+    return result;
+}
+
+#else
+#   error Implement processStartAndWait for you OS.
+#endif
+
 //----------------------------------------------------------------------------------------------------------------------{PNG}
 //----------------------------------------------------------------------------------------------------------------------
 // PNG writing
@@ -2453,6 +7125,8 @@ internal u32 __pngAdler32(u32 state, const u8* data, i64 len)
 
 bool pngWrite(const char* fileName, u32* img, int width, int height)
 {
+    K_TRACE_BEGIN("pngWrite");
+
     // Swizzle image from ARGB to ABGR
     u32* newImg = K_ALLOC(sizeof(u32)*width*height);
     u8* src = (u8 *)img;
@@ -2488,14 +7162,19 @@ bool pngWrite(const char* fileName, u32* img, int width, int height)
     i64 deflateRemain = imgSize;
     u8* imgBytes = (u8 *)img;
 
-    fileSize = 43;
-    fileSize += dataSize + 4;       // IDAT deflated data
+    fileSize = 8 + 25;              // PNG header, IHDR chunk
+    fileSize += 12 + dataSize;      // IDAT chunk
+    fileSize += 12;                 // IEND chunk
 
-                                    // Open arena
-    Arena m;
-    arenaInit(&m, dataSize + K_KB(1));
-    u8* p = arenaAlloc(&m, 43);
-    u8* start = p;
+    // Write straight into the mapped file.  It starts at its final size so it never grows and the writes can't fail.
+    DataWriter w;
+    if (!dataWriterOpen(&w, fileName, fileSize))
+    {
+        K_FREE(newImg, sizeof(u32)*width*height);
+        K_TRACE_END();
+        return NO;
+    }
+    u8* p = dataWriterAlloc(&w, 43);
 
     // Write file format
     u8 header[] = {
@@ -2544,7 +7223,7 @@ bool pngWrite(const char* fileName, u32* img, int width, int height)
                 (size) ^ 0xff,
                 (size >> 8) ^ 0xff
             };
-            p = arenaAlloc(&m, sizeof(blockHeader));
+            p = dataWriterAlloc(&w, sizeof(blockHeader));
             memoryCopy(blockHeader, p, sizeof(blockHeader));
             crc = crc32Update(crc, blockHeader, sizeof(blockHeader));
         }
@@ -2569,7 +7248,7 @@ bool pngWrite(const char* fileName, u32* img, int width, int height)
         // Beginning of row - write filter method
         if (x == 0)
         {
-            p = arenaAlloc(&m, 1);
+            p = dataWriterAlloc(&w, 1);
             *p = 0;
             crc = crc32Update(crc, p, 1);
             adler = __pngAdler32(adler, p, 1);
@@ -2580,7 +7259,7 @@ bool pngWrite(const char* fileName, u32* img, int width, int height)
         }
 
         // Write bytes and update checksums
-        p = arenaAlloc(&m, n);
+        p = dataWriterAlloc(&w, n);
         memoryCopy(imgBytes, p, n);
         crc = crc32Update(crc, imgBytes, n);
         adler = __pngAdler32(adler, imgBytes, n);
@@ -2613,29 +7292,18 @@ bool pngWrite(const char* fileName, u32* img, int width, int height)
                 footer[6] = crc >> 8;
                 footer[7] = crc;
 
-                p = arenaAlloc(&m, 20);
+                p = dataWriterAlloc(&w, 20);
                 memoryCopy(footer, p, 20);
                 break;
             }
         }
     }
 
-    // Transfer file
     K_FREE(newImg, sizeof(u32)*width*height);
-    u8* end = arenaAlloc(&m, 0);
-    i64 numBytes = (i64)(end - start);
-    Data d = dataMake(fileName, numBytes);
-    if (d.bytes)
-    {
-        memoryCopy(start, d.bytes, numBytes);
-        dataUnload(d);
-        arenaDone(&m);
-        return YES;
-    }
-    else
-    {
-        return NO;
-    }
+    K_ASSERT(w.size == fileSize, "PNG size calculated incorrectly");
+    bool result = dataWriterClose(&w);
+    K_TRACE_END();
+    return result;
 }
 
 //----------------------------------------------------------------------------------------------------------------------{REGEX}
@@ -2855,14 +7523,14 @@ internal bool regexMatchDigit(i8 c)
 internal bool regexMatchHex(i8 c)
 {
     return K_BOOL(regexMatchDigit(c) ||
-                  (c >= 'a') && (c <= 'f') ||
-                  (c >= 'A') && (c <= 'F'));
+                  ((c >= 'a') && (c <= 'f')) ||
+                  ((c >= 'A') && (c <= 'F')));
 }
 
 internal bool regexMatchAlpha(i8 c)
 {
-    return K_BOOL((c >= 'a') && (c <= 'z') ||
-                  (c >= 'A') && (c <= 'Z'));
+    return K_BOOL(((c >= 'a') && (c <= 'z')) ||
+                  ((c >= 'A') && (c <= 'Z')));
 }
 
 internal bool regexMatchAlphaNum(i8 c)
@@ -196,7 +196,6 @@ bool keyAltPressed(const WindowEvent* ev, int key);       // YES if a particular
 
 typedef struct
 {
-    i64         poolIndex;      // Used so that poolFor works.
     Window      window;         // Current state
 
 #if K_OS_WIN32
@@ -208,14 +207,14 @@ typedef struct
 #endif
 #endif
 
-    Array(WindowEvent)  events;
+    Queue(WindowEvent)  events;
     Rect        originalBounds;     // Used to store original bounds when fullscreen is activated.
 }
 WindowInfo;
 
-Pool(WindowInfo) g_windows = 0;
+HandlePool g_windows = { 0 };      // Window handles are handles into this pool.
 int g_windowCount = 0;
-Array(WindowEvent) g_globalEvents = 0;
+Queue(WindowEvent) g_globalEvents = 0;
 
 //----------------------------------------------------------------------------------------------------------------------
 
@@ -224,8 +223,11 @@ internal WindowInfo* _windowGet(int handle)
     if (K_CREATE_HANDLE == handle)
     {
         // Allocate a new handle
-        WindowInfo* info = poolAcquire(g_windows);
-        info->window.handle = (int)poolIndexOf(g_windows, info);
+        Handle h;
+        if (!g_windows.elemSize) handlePoolInit(&g_windows, sizeof(WindowInfo));
+        WindowInfo* info = (WindowInfo *)handlePoolAcquire(&g_windows, &h);
+        K_ASSERT(info);
+        info->window.handle = (int)h;
         info->events = 0;
         ++g_windowCount;
         return info;
@@ -236,20 +238,22 @@ internal WindowInfo* _windowGet(int handle)
     }
     else
     {
-        return &g_windows[handle];
+        // Returns 0 for handles of windows that have already been destroyed.
+        return (WindowInfo *)handlePoolGet(&g_windows, (Handle)handle);
     }
 }
 
 //----------------------------------------------------------------------------------------------------------------------
 
-internal void _windowDestroy(WindowInfo* info)
+internal void _windowDestroy(int handle)
 {
-    arrayDone(info->events);
-    poolRecycle(g_windows, poolIndexOf(g_windows, info));
+    WindowInfo* info = _windowGet(handle);
+    queueDone(info->events);
     stringDone(&info->window.title);
+    handlePoolRecycle(&g_windows, (Handle)handle);
     if (--g_windowCount == 0)
     {
-        poolDone(g_windows);
+        handlePoolDone(&g_windows);
         PostQuitMessage(0);
     }
 }
@@ -414,7 +418,8 @@ internal LRESULT CALLBACK _windowProc(HWND wnd, UINT msg, WPARAM w, LPARAM l)
     else
     {
         int handle = (int)GetWindowLongA(wnd, 0);
-        WindowInfo* info = &g_windows[handle];
+        WindowInfo* info = _windowGet(handle);
+        if (!info) return DefWindowProcA(wnd, msg, w, l);
         WindowEvent ev = { 0 };
         ev.handle = handle;
 
@@ -729,7 +734,8 @@ void windowDone(Window* window)
 {
     if (window->handle != K_CREATE_HANDLE)
     {
-        WindowInfo* info = _windowGet(window->handle);
+        int handle = window->handle;
+        WindowInfo* info = _windowGet(handle);
 #if K_OS_WIN32
         if (info)
         {
@@ -740,7 +746,7 @@ void windowDone(Window* window)
         }
 #endif
         window->handle = K_DESTROYED_HANDLE;
-        if (info) _windowDestroy(info);
+        if (info) _windowDestroy(handle);
     }
 }
 
@@ -750,6 +756,7 @@ void windowDone(Window* window)
 
 bool windowPoll(WindowEvent* event)
 {
+    K_TRACE_BEGIN("windowPoll");
     event->type = K_EVENT_NONE;
 
     // Get the events from the OS - this will queue up events on windows or the global queue.
@@ -764,6 +771,7 @@ bool windowPoll(WindowEvent* event)
         if (!GetMessageA(&msg, 0, 0, 0))
         {
             event->type = K_EVENT_QUIT;
+            K_TRACE_END();
             return YES;
         };
 
@@ -773,29 +781,29 @@ bool windowPoll(WindowEvent* event)
 #endif
 
     // Scan the known windows for any events.
-    poolFor(g_windows) {
-        WindowInfo* info = &g_windows[i];
-        if (arrayCount(info->events) > 0)
+    handlePoolFor(&g_windows) {
+        WindowInfo* info = (WindowInfo *)handlePoolAt(&g_windows, i);
+        if (queueCount(info->events) > 0)
         {
-            *event = info->events[0];
-            arrayDelete(info->events, 0);
+            *event = queuePopFront(info->events);
+            K_TRACE_END();
             return YES;
         }
     }
 
     // Scan the global events.
-    if (arrayCount(g_globalEvents) > 0)
+    if (queueCount(g_globalEvents) > 0)
     {
-        *event = g_globalEvents[0];
-        arrayDelete(g_globalEvents, 0);
-        if (arrayCount(g_globalEvents) == 0)
+        *event = queuePopFront(g_globalEvents);
+        if (queueCount(g_globalEvents) == 0)
         {
-            arrayDone(g_globalEvents);
-            g_globalEvents = 0;
+            queueDone(g_globalEvents);
         }
+        K_TRACE_END();
         return YES;
     }
 
+    K_TRACE_END();
     return NO;
 }
 
@@ -805,14 +813,14 @@ void windowAddEvent(Window* window, const WindowEvent* event)
 {
     K_ASSERT(window->handle != K_CREATE_HANDLE);
     WindowInfo* info = _windowGet(window->handle);
-    *arrayExpand(info->events, 1) = *event;
+    queuePushBack(info->events, *event);
 }
 
 //----------------------------------------------------------------------------------------------------------------------
 
 void windowAddGlobalEvent(const WindowEvent* event)
 {
-    *arrayExpand(g_globalEvents, 1) = *event;
+    queuePushBack(g_globalEvents, *event);
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -145,7 +145,6 @@ typedef struct
     String          m_source;
     LexConfig       m_config;
     LexOutputFunc   m_outputFunc;
-    Arena           m_scratch;
     Arena*          m_symbols;
     const i8*       m_start;
     const i8*       m_end;
@@ -199,6 +198,7 @@ Array(LexInfo) lexGetTokens(Lex* L);
 #ifdef K_IMPLEMENTATION
 
 #include <ctype.h>
+#include <wctype.h>
 
 //----------------------------------------------------------------------------------------------------------------------
 // Configuration
@@ -308,7 +308,6 @@ Token lexConfigAddKeyword(LexConfig* LC, const i8* keyword)
 void lexDone(Lex* L)
 {
     arrayDone(L->m_info);
-    arenaDone(&L->m_scratch);
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -353,9 +352,9 @@ internal void lexUngetChar(Lex* L)
 internal Token lexErrorV(Lex* L, const i8* format, va_list args)
 {
     String msg;
-    arenaPush(&L->m_scratch);
-    msg = arenaStringFormatV(&L->m_scratch, format, args);
-    L->m_outputFunc(arenaStringFormat(&L->m_scratch, "%s(%d): Lexical Error: %s\n", L->m_source, L->m_lastPosition.m_line, msg));
+    Scratch scratch = scratchBegin(0);
+    msg = arenaStringFormatV(scratch.arena, format, args);
+    L->m_outputFunc(arenaStringFormat(scratch.arena, "%s(%d): Lexical Error: %s\n", L->m_source, L->m_lastPosition.m_line, msg));
 
     {
         int x = L->m_lastPosition.m_col - 1;
@@ -375,7 +374,7 @@ internal Token lexErrorV(Lex* L, const i8* format, va_list args)
         L->m_outputFunc("^\n");
     }
 
-    arenaPop(&L->m_scratch);
+    scratchEnd(scratch);
     return T_Error;
 
 }
@@ -798,7 +797,6 @@ void lex(Lex* L, LexConfig* config, LexOutputFunc outputFunc, StringTable* symbo
     L->m_source = source;
     L->m_config = *config;
     L->m_outputFunc = outputFunc;
-    arenaInit(&L->m_scratch, 128);
     L->m_symbols = symbols;
     L->m_start = start;
     L->m_end = end;
@@ -811,11 +809,13 @@ void lex(Lex* L, LexConfig* config, LexOutputFunc outputFunc, StringTable* symbo
     L->m_lastPosition = L->m_position;
 
     // Analyse!
+    K_TRACE_BEGIN("lex");
     Token t = T_Unknown;
     while ((t = lexNext(L)) != T_EOF && t != T_Error)
     {
 
     }
+    K_TRACE_END();
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -831,13 +831,12 @@ void lexDump(Lex* L)
         "INTEGER",
         "REAL",
     };
-    Arena scratch;
-    arenaInit(&scratch, K_KB(1));
+    Scratch scratch = scratchBegin(0);
 
     for (i64 i = 0; i < arrayCount(L->m_info); ++i)
     {
         LexInfo* li = &L->m_info[i];
-        arenaPush(&scratch);
+        arenaPush(scratch.arena);
 
         // Print token information
         const i8* name = "";
@@ -856,21 +855,21 @@ void lexDump(Lex* L)
         {
             name = typeNames[li->m_token];
         }
-        L->m_outputFunc(arenaStringFormat(&scratch, "%d: %s%s", L->m_info[i].m_position.m_line, prefix, name));
+        L->m_outputFunc(arenaStringFormat(scratch.arena, "%d: %s%s", L->m_info[i].m_position.m_line, prefix, name));
 
         // Print interpretation of token
         switch (li->m_token)
         {
         case T_Symbol:
-            L->m_outputFunc(arenaStringFormat(&scratch, ": %s", stringTableGet(L->m_symbols, li->m_symbol)));
+            L->m_outputFunc(arenaStringFormat(scratch.arena, ": %s", stringTableGet(L->m_symbols, li->m_symbol)));
             break;
 
         case T_Integer:
-            L->m_outputFunc(arenaStringFormat(&scratch, ": %lld", li->m_integer));
+            L->m_outputFunc(arenaStringFormat(scratch.arena, ": %lld", li->m_integer));
             break;
 
         case T_Real:
-            L->m_outputFunc(arenaStringFormat(&scratch, ": %f", li->m_real));
+            L->m_outputFunc(arenaStringFormat(scratch.arena, ": %f", li->m_real));
             break;
         }
 
@@ -896,10 +895,10 @@ void lexDump(Lex* L)
             for (int j = 0; j < len - 1; ++j) L->m_outputFunc("~");
             L->m_outputFunc("\n");
         }
-        arenaPop(&scratch);
+        arenaPop(scratch.arena);
     }
 
-    arenaDone(&scratch);
+    scratchEnd(scratch);
 }
 
 //----------------------------------------------------------------------------------------------------------------------
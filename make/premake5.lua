@@ -6,12 +6,16 @@ filter { "platforms:Win64" }
 	system "Windows"
 	architecture "x64"
 
+filter { "platforms:Linux64" }
+	system "Linux"
+	architecture "x64"
+
 
 -- Solution
 solution "kore"
 	language "C++"
 	configurations { "Debug", "Release" }
-	platforms { "Win64" }
+	platforms { "Win64", "Linux64" }
 	location "../_build"
     debugdir ".."
     characterset "MBCS"
@@ -20,12 +24,17 @@ solution "kore"
 		"_CRT_SECURE_NO_WARNINGS",
 	}
 
-    linkoptions "/opt:ref"
     editandcontinue "off"
 
     rtti "off"
     exceptionhandling "off"
 
+	filter { "system:Windows" }
+		linkoptions "/opt:ref"
+
+	filter { "system:Linux" }
+		buildoptions "-std=gnu11"
+
 	configuration "Debug"
 		defines { "_DEBUG" }
 		flags { "FatalWarnings" }
@@ -40,9 +49,10 @@ solution "kore"
 		targetdir "../_bin/%{cfg.platform}/%{cfg.buildcfg}/%{prj.name}"
 		objdir "../_obj/%{cfg.platform}/%{cfg.buildcfg}/%{prj.name}"
 		kind "WindowedApp"
+		removeplatforms { "Linux64" }
 		files {
 			"../include/**.h",
-			"../src/**.c",
+			"../src/test_kore.c",
 		}
 		includedirs {
 			"../include",
@@ -61,3 +71,65 @@ solution "kore"
 				"NoMinimalRebuild",
 				"NoIncrementalLink",
 			}
+
+	project "kbench"
+		targetdir "../_bin/%{cfg.platform}/%{cfg.buildcfg}/%{prj.name}"
+		objdir "../_obj/%{cfg.platform}/%{cfg.buildcfg}/%{prj.name}"
+		kind "ConsoleApp"
+		language "C"
+		files {
+			"../include/**.h",
+			"../src/bench/**.c",
+		}
+		includedirs {
+			"../include",
+		}
+
+		configuration "Win*"
+			defines {
+				"WIN32",
+			}
+			flags {
+				"StaticRuntime",
+				"NoMinimalRebuild",
+				"NoIncrementalLink",
+			}
+
+		configuration "Linux*"
+			links {
+				"pthread",
+				"m",
+			}
+
+	-- kbench with the slab allocator, to compare against kbench
+	project "kbench_slab"
+		targetdir "../_bin/%{cfg.platform}/%{cfg.buildcfg}/%{prj.name}"
+		objdir "../_obj/%{cfg.platform}/%{cfg.buildcfg}/%{prj.name}"
+		kind "ConsoleApp"
+		language "C"
+		files {
+			"../include/**.h",
+			"../src/bench/**.c",
+		}
+		includedirs {
+			"../include",
+		}
+		defines {
+			"K_MEMORY_SLAB=YES",
+		}
+
+		configuration "Win*"
+			defines {
+				"WIN32",
+			}
+			flags {
+				"StaticRuntime",
+				"NoMinimalRebuild",
+				"NoIncrementalLink",
+			}
+
+		configuration "Linux*"
+			links {
+				"pthread",
+				"m",
+			}
@@ -0,0 +1,766 @@
+//----------------------------------------------------------------------------------------------------------------------
+// Kore benchmarks
+//
+// Usage: kbench [-csv | -json] [-o <file>] [<filter>]
+//
+// Only benchmarks with <filter> in their "suite/name" are run.  Results go to stdout as a table unless -csv or -json
+// is given.  Compare the CSV or JSON from two builds to find regressions.
+//
+// kbench_slab is the same program built with K_MEMORY_SLAB set to YES.  Compare its alloc/K_ALLOC result with kbench's
+// to see what the slab allocator buys.
+//----------------------------------------------------------------------------------------------------------------------
+
+#define K_IMPLEMENTATION
+#include <kore/kore.h>
+#include <kore/kbench.h>
+#include <kore/parser.h>
+
+//----------------------------------------------------------------------------------------------------------------------
+// Test data
+//----------------------------------------------------------------------------------------------------------------------
+
+#define BENCH_BUFFER_SIZE   K_MB(1)
+#define BENCH_NUM_STRINGS   16384
+
+typedef struct
+{
+    u8*         buffer;
+    i64         size;
+}
+BufferData;
+
+internal u8* gBuffer = 0;
+internal String* gStrings = 0;
+
+internal void benchDataInit()
+{
+    Random R;
+    randomInitSeed(&R, 12345);
+
+    gBuffer = K_ALLOC(BENCH_BUFFER_SIZE);
+    for (i64 i = 0; i < BENCH_BUFFER_SIZE; ++i) gBuffer[i] = (u8)random64(&R);
+
+    gStrings = K_ALLOC(sizeof(String) * BENCH_NUM_STRINGS);
+    for (int i = 0; i < BENCH_NUM_STRINGS; ++i)
+    {
+        gStrings[i] = stringFormat((const i8 *)"symbol_%llx_%d", (long long)random64(&R), i);
+    }
+}
+
+internal void benchDataDone()
+{
+    for (int i = 0; i < BENCH_NUM_STRINGS; ++i) stringDone(&gStrings[i]);
+    K_FREE(gStrings, sizeof(String) * BENCH_NUM_STRINGS);
+    K_FREE(gBuffer, BENCH_BUFFER_SIZE);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Hashing
+//----------------------------------------------------------------------------------------------------------------------
+
+internal void benchHash(void* data, i64 iterations)
+{
+    BufferData* bd = (BufferData *)data;
+    for (i64 i = 0; i < iterations; ++i)
+    {
+        u64 h = hash(bd->buffer, bd->size);
+        benchDoNotOptimize(&h);
+    }
+}
+
+internal void benchCrc32(void* data, i64 iterations)
+{
+    BufferData* bd = (BufferData *)data;
+    for (i64 i = 0; i < iterations; ++i)
+    {
+        u32 crc = crc32(bd->buffer, bd->size);
+        benchDoNotOptimize(&crc);
+    }
+}
+
+internal void benchSha1(void* data, i64 iterations)
+{
+    BufferData* bd = (BufferData *)data;
+    Sha1 s;
+    for (i64 i = 0; i < iterations; ++i)
+    {
+        sha1Init(&s);
+        sha1Add(&s, bd->buffer, bd->size);
+        sha1Finalise(&s);
+        benchDoNotOptimize(&s);
+    }
+}
+
+internal void benchBuffers(Bench* B, const char* suite, BenchFunc func)
+{
+    static BufferData sizes[] = {
+        { 0, 64 },
+        { 0, K_KB(4) },
+        { 0, BENCH_BUFFER_SIZE },
+    };
+    static const char* names[] = { "64B", "4KB", "1MB" };
+
+    benchSuite(B, suite);
+    for (int i = 0; i < (int)K_ARRAY_COUNT(sizes); ++i)
+    {
+        sizes[i].buffer = gBuffer;
+        benchRun(B, names[i], func, &sizes[i], sizes[i].size);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// String tables
+//----------------------------------------------------------------------------------------------------------------------
+
+// Build a new table from all the strings each time round, so every add is an insert.
+internal void benchStringTableInsert(void* data, i64 iterations)
+{
+    StringTable table;
+    i64 remaining = iterations;
+    while (remaining > 0)
+    {
+        i64 count = K_MIN(remaining, BENCH_NUM_STRINGS);
+        stringTableInit(&table, K_KB(64), 1024);
+        for (i64 i = 0; i < count; ++i)
+        {
+            StringToken t = stringTableAdd(&table, gStrings[i]);
+            benchDoNotOptimize(&t);
+        }
+        stringTableDone(&table);
+        remaining -= count;
+    }
+}
+
+// Add strings that are already in the table.
+internal void benchStringTableFind(void* data, i64 iterations)
+{
+    StringTable* table = (StringTable *)data;
+    for (i64 i = 0; i < iterations; ++i)
+    {
+        StringToken t = stringTableAdd(table, gStrings[i & (BENCH_NUM_STRINGS - 1)]);
+        benchDoNotOptimize(&t);
+    }
+}
+
+internal void benchStringTables(Bench* B)
+{
+    StringTable table;
+    stringTableInit(&table, K_KB(64), 1024);
+    for (int i = 0; i < BENCH_NUM_STRINGS; ++i) stringTableAdd(&table, gStrings[i]);
+
+    benchSuite(B, "stringTableAdd");
+    benchRun(B, "insert", &benchStringTableInsert, 0, 0);
+    benchRun(B, "existing", &benchStringTableFind, &table, 0);
+
+    stringTableDone(&table);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Memory
+//----------------------------------------------------------------------------------------------------------------------
+
+typedef struct
+{
+    Arena       arena;
+    i64         size;
+}
+ArenaData;
+
+internal void benchArenaAlloc(void* data, i64 iterations)
+{
+    ArenaData* ad = (ArenaData *)data;
+    i64 remaining = iterations;
+    while (remaining > 0)
+    {
+        i64 count = K_MIN(remaining, 4096);
+        arenaPush(&ad->arena);
+        for (i64 i = 0; i < count; ++i)
+        {
+            void* p = arenaAlloc(&ad->arena, ad->size);
+            benchDoNotOptimize(p);
+        }
+        arenaPop(&ad->arena);
+        remaining -= count;
+    }
+}
+
+// Grow an array from empty to 64K elements, over and over.
+internal void benchArrayAdd(void* data, i64 iterations)
+{
+    Array(i64) a = 0;
+    for (i64 i = 0; i < iterations; ++i)
+    {
+        if ((i & 0xffff) == 0) arrayDone(a);
+        arrayAdd(a, i);
+        benchDoNotOptimize(a);
+    }
+    arrayDone(a);
+}
+
+// Add to an array that already has the space.
+internal void benchArrayAddReserved(void* data, i64 iterations)
+{
+    Array(i64) a = 0;
+    arrayReserve(a, 0x10000);
+    for (i64 i = 0; i < iterations; ++i)
+    {
+        if ((i & 0xffff) == 0) arrayClear(a);
+        arrayAdd(a, i);
+        benchDoNotOptimize(a);
+    }
+    arrayDone(a);
+}
+
+internal void benchMemory(Bench* B)
+{
+    ArenaData small, large;
+    arenaInit(&small.arena, K_MB(1));
+    arenaInit(&large.arena, K_MB(64));
+    small.size = 16;
+    large.size = K_KB(4);
+
+    benchSuite(B, "arenaAlloc");
+    benchRun(B, "16B", &benchArenaAlloc, &small, 0);
+    benchRun(B, "4KB", &benchArenaAlloc, &large, 0);
+
+    arenaDone(&small.arena);
+    arenaDone(&large.arena);
+
+    benchSuite(B, "arrayAdd");
+    benchRun(B, "grow", &benchArrayAdd, 0, sizeof(i64));
+    benchRun(B, "reserved", &benchArrayAddReserved, 0, sizeof(i64));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Allocators
+//----------------------------------------------------------------------------------------------------------------------
+
+#define BENCH_ALLOC_LIVE    4096
+#define BENCH_ALLOC_SIZES   65536       // Must be a power of 2.
+
+typedef struct
+{
+    i64*        sizes;
+    void**      live;
+    i64*        liveSizes;
+    i64         next;
+}
+AllocData;
+
+// Free the oldest of BENCH_ALLOC_LIVE blocks and allocate a new one, with K_ALLOC/K_FREE.
+internal void benchKoreAlloc(void* data, i64 iterations)
+{
+    AllocData* ad = (AllocData *)data;
+    for (i64 i = 0; i < iterations; ++i, ++ad->next)
+    {
+        i64 slot = ad->next % BENCH_ALLOC_LIVE;
+        i64 size = ad->sizes[ad->next & (BENCH_ALLOC_SIZES - 1)];
+        if (ad->live[slot]) K_FREE(ad->live[slot], ad->liveSizes[slot]);
+        ad->live[slot] = K_ALLOC(size);
+        ad->liveSizes[slot] = size;
+        benchDoNotOptimize(ad->live[slot]);
+    }
+}
+
+// The same with malloc/free.
+internal void benchLibcAlloc(void* data, i64 iterations)
+{
+    AllocData* ad = (AllocData *)data;
+    for (i64 i = 0; i < iterations; ++i, ++ad->next)
+    {
+        i64 slot = ad->next % BENCH_ALLOC_LIVE;
+        free(ad->live[slot]);
+        ad->live[slot] = malloc(ad->sizes[ad->next & (BENCH_ALLOC_SIZES - 1)]);
+        benchDoNotOptimize(ad->live[slot]);
+    }
+}
+
+internal void benchAllocators(Bench* B)
+{
+    Random R;
+    randomInitSeed(&R, 42);
+
+    // 90% of the blocks are headers or small arrays, the rest are up to 4K.
+    i64* sizes = K_ALLOC(sizeof(i64) * BENCH_ALLOC_SIZES);
+    for (i64 i = 0; i < BENCH_ALLOC_SIZES; ++i)
+    {
+        u64 r = random64(&R);
+        sizes[i] = (r % 10) ? 8 + (i64)((r >> 8) % 248) : 8 + (i64)((r >> 8) % 4088);
+    }
+
+    AllocData kore = { sizes, K_ALLOC_CLEAR(sizeof(void*) * BENCH_ALLOC_LIVE) };
+    AllocData libc = { sizes, K_ALLOC_CLEAR(sizeof(void*) * BENCH_ALLOC_LIVE) };
+    kore.liveSizes = K_ALLOC_CLEAR(sizeof(i64) * BENCH_ALLOC_LIVE);
+
+    benchSuite(B, "alloc");
+    benchRun(B, "K_ALLOC", &benchKoreAlloc, &kore, 0);
+    benchRun(B, "malloc", &benchLibcAlloc, &libc, 0);
+
+    for (int i = 0; i < BENCH_ALLOC_LIVE; ++i)
+    {
+        if (kore.live[i]) K_FREE(kore.live[i], kore.liveSizes[i]);
+        free(libc.live[i]);
+    }
+    K_FREE(libc.live, sizeof(void*) * BENCH_ALLOC_LIVE);
+    K_FREE(kore.liveSizes, sizeof(i64) * BENCH_ALLOC_LIVE);
+    K_FREE(kore.live, sizeof(void*) * BENCH_ALLOC_LIVE);
+    K_FREE(sizes, sizeof(i64) * BENCH_ALLOC_SIZES);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Huge pages
+//
+// Random reads from a 1GB virtual arena backed by normal pages and then by huge pages.  Almost every read misses the
+// TLB with normal pages.  To count the misses, run each one under perf:
+//
+//      perf stat -e dTLB-load-misses kbench arenaRead/normal
+//      perf stat -e dTLB-load-misses kbench arenaRead/huge
+//----------------------------------------------------------------------------------------------------------------------
+
+#define BENCH_HUGE_ARENA_SIZE   K_GB((i64)1)
+
+typedef struct
+{
+    u64*        data;
+    i64         count;
+    Random      R;
+}
+ArenaReadData;
+
+internal void benchArenaRead(void* data, i64 iterations)
+{
+    ArenaReadData* rd = (ArenaReadData *)data;
+    u64 sum = 0;
+    for (i64 i = 0; i < iterations; ++i) sum += rd->data[random64(&rd->R) % rd->count];
+    benchDoNotOptimize(&sum);
+}
+
+internal void benchArenaReads(Bench* B, const char* name, bool huge)
+{
+    Arena arena;
+    ArenaReadData rd;
+
+    if (!benchEnabled(B, name)) return;
+
+    if (huge)
+    {
+        arenaInitHuge(&arena, BENCH_HUGE_ARENA_SIZE + K_MB(4));
+    }
+    else
+    {
+        arenaInitVirtual(&arena, BENCH_HUGE_ARENA_SIZE + K_MB(4), 0);
+    }
+
+    rd.count = BENCH_HUGE_ARENA_SIZE / sizeof(u64);
+    rd.data = K_ARENA_ALLOC(&arena, u64, rd.count);
+    randomInitSeed(&rd.R, 42);
+    if (rd.data)
+    {
+        for (i64 i = 0; i < rd.count; ++i) rd.data[i] = (u64)i;
+        benchRun(B, name, &benchArenaRead, &rd, 0);
+    }
+
+    arenaDone(&arena);
+}
+
+internal void benchHugePages(Bench* B)
+{
+    benchSuite(B, "arenaRead");
+    benchArenaReads(B, "normal", NO);
+    benchArenaReads(B, "huge", YES);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Pool contention
+//
+// Threads repeatedly acquire a batch of elements and recycle them, from a ConcurrentPool and from a Pool guarded by a
+// lock.  An iteration is one acquire and one recycle.  The iterations are shared between the threads, so the time per
+// iteration is wall time, including starting the threads.
+//----------------------------------------------------------------------------------------------------------------------
+
+#define BENCH_POOL_BATCH        16
+#define BENCH_POOL_MAX_THREADS  16
+
+#if K_OS_WIN32
+typedef CRITICAL_SECTION BenchLock;
+#   define benchLockInit(l)     InitializeCriticalSection(l)
+#   define benchLockDone(l)     DeleteCriticalSection(l)
+#   define benchLock(l)         EnterCriticalSection(l)
+#   define benchUnlock(l)       LeaveCriticalSection(l)
+#else
+typedef pthread_mutex_t BenchLock;
+#   define benchLockInit(l)     pthread_mutex_init((l), 0)
+#   define benchLockDone(l)     pthread_mutex_destroy(l)
+#   define benchLock(l)         pthread_mutex_lock(l)
+#   define benchUnlock(l)       pthread_mutex_unlock(l)
+#endif
+
+typedef struct
+{
+    i64     data[4];
+}
+BenchPoolElem;
+
+typedef struct
+{
+    ConcurrentPool          concurrent;
+    Pool(BenchPoolElem)     locked;
+    BenchLock               lock;
+    BenchFunc               func;           // What each thread runs.
+    int                     numThreads;
+    i64                     iterations;     // Per thread.
+}
+PoolData;
+
+internal void benchConcurrentPool(void* data, i64 iterations)
+{
+    PoolData* pd = (PoolData *)data;
+    i64 indices[BENCH_POOL_BATCH];
+
+    for (i64 i = 0; i < iterations; i += BENCH_POOL_BATCH)
+    {
+        int n = (int)K_MIN(BENCH_POOL_BATCH, iterations - i);
+        for (int j = 0; j < n; ++j)
+        {
+            BenchPoolElem* e = (BenchPoolElem *)concurrentPoolAcquire(&pd->concurrent, &indices[j]);
+            e->data[0] = i;
+        }
+        for (int j = 0; j < n; ++j) concurrentPoolRecycle(&pd->concurrent, indices[j]);
+    }
+
+    concurrentPoolFlush(&pd->concurrent);
+}
+
+internal void benchLockedPool(void* data, i64 iterations)
+{
+    PoolData* pd = (PoolData *)data;
+    i64 indices[BENCH_POOL_BATCH];
+
+    for (i64 i = 0; i < iterations; i += BENCH_POOL_BATCH)
+    {
+        int n = (int)K_MIN(BENCH_POOL_BATCH, iterations - i);
+        for (int j = 0; j < n; ++j)
+        {
+            benchLock(&pd->lock);
+            BenchPoolElem* e = poolAcquire(pd->locked);
+            indices[j] = poolIndexOf(pd->locked, e);
+            e->data[0] = i;
+            benchUnlock(&pd->lock);
+        }
+        for (int j = 0; j < n; ++j)
+        {
+            benchLock(&pd->lock);
+            poolRecycle(pd->locked, indices[j]);
+            benchUnlock(&pd->lock);
+        }
+    }
+}
+
+#if K_OS_WIN32
+internal DWORD WINAPI benchPoolThread(LPVOID param)
+{
+    PoolData* pd = (PoolData *)param;
+    pd->func(pd, pd->iterations);
+    return 0;
+}
+#else
+internal void* benchPoolThread(void* param)
+{
+    PoolData* pd = (PoolData *)param;
+    pd->func(pd, pd->iterations);
+    return 0;
+}
+#endif
+
+// Share the iterations between numThreads threads, using this thread for one of them.
+internal void benchPoolThreads(void* data, i64 iterations)
+{
+    PoolData* pd = (PoolData *)data;
+    int numThreads = pd->numThreads;
+    pd->iterations = (iterations + numThreads - 1) / numThreads;
+
+#if K_OS_WIN32
+    HANDLE threads[BENCH_POOL_MAX_THREADS];
+    for (int i = 0; i < numThreads - 1; ++i) threads[i] = CreateThread(0, 0, &benchPoolThread, pd, 0, 0);
+    pd->func(pd, pd->iterations);
+    for (int i = 0; i < numThreads - 1; ++i)
+    {
+        if (threads[i])
+        {
+            WaitForSingleObject(threads[i], INFINITE);
+            CloseHandle(threads[i]);
+        }
+        else
+        {
+            pd->func(pd, pd->iterations);
+        }
+    }
+#else
+    pthread_t threads[BENCH_POOL_MAX_THREADS];
+    bool started[BENCH_POOL_MAX_THREADS];
+    for (int i = 0; i < numThreads - 1; ++i) started[i] = pthread_create(&threads[i], 0, &benchPoolThread, pd) == 0;
+    pd->func(pd, pd->iterations);
+    for (int i = 0; i < numThreads - 1; ++i)
+    {
+        if (started[i])
+        {
+            pthread_join(threads[i], 0);
+        }
+        else
+        {
+            pd->func(pd, pd->iterations);
+        }
+    }
+#endif
+}
+
+internal void benchPoolContention(Bench* B)
+{
+    static const struct
+    {
+        int             numThreads;
+        const char*     lockFree;
+        const char*     locked;
+    }
+    runs[] = {
+        { 1, "lockFree-1", "locked-1" },
+        { 2, "lockFree-2", "locked-2" },
+        { 4, "lockFree-4", "locked-4" },
+        { 8, "lockFree-8", "locked-8" },
+        { BENCH_POOL_MAX_THREADS, "lockFree-16", "locked-16" },
+    };
+
+    PoolData pd;
+    benchLockInit(&pd.lock);
+    benchSuite(B, "poolContention");
+
+    for (int i = 0; i < (int)K_ARRAY_COUNT(runs); ++i)
+    {
+        pd.numThreads = runs[i].numThreads;
+
+        concurrentPoolInit(&pd.concurrent, sizeof(BenchPoolElem));
+        pd.func = &benchConcurrentPool;
+        benchRun(B, runs[i].lockFree, &benchPoolThreads, &pd, 0);
+        concurrentPoolDone(&pd.concurrent);
+
+        pd.locked = 0;
+        pd.func = &benchLockedPool;
+        benchRun(B, runs[i].locked, &benchPoolThreads, &pd, 0);
+        poolDone(pd.locked);
+    }
+
+    benchLockDone(&pd.lock);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Regular expressions
+//----------------------------------------------------------------------------------------------------------------------
+
+typedef struct
+{
+    RegEx       re;
+    const i8*   text;
+}
+RegExData;
+
+internal void benchRegexMatch(void* data, i64 iterations)
+{
+    RegExData* rd = (RegExData *)data;
+    for (i64 i = 0; i < iterations; ++i)
+    {
+        int index = regexMatch(rd->re, rd->text);
+        benchDoNotOptimize(&index);
+    }
+}
+
+internal void benchRegexCompileMatch(void* data, i64 iterations)
+{
+    RegExData* rd = (RegExData *)data;
+    for (i64 i = 0; i < iterations; ++i)
+    {
+        int index = match((const i8 *)"[0-9]+\\.[0-9]+f", rd->text);
+        benchDoNotOptimize(&index);
+    }
+}
+
+internal void benchRegex(Bench* B)
+{
+    static const char* text = "The quick brown fox jumps over the lazy dog 1234 times at 56.78f metres per second";
+    RegExData found = { regexCompile((const i8 *)"[0-9]+\\.[0-9]+f"), (const i8 *)text };
+    RegExData missing = { regexCompile((const i8 *)"[0-9]+\\.[0-9]+e"), (const i8 *)text };
+
+    benchSuite(B, "regexMatch");
+    benchRun(B, "found", &benchRegexMatch, &found, (i64)strlen(text));
+    benchRun(B, "missing", &benchRegexMatch, &missing, (i64)strlen(text));
+    benchRun(B, "compile", &benchRegexCompileMatch, &found, (i64)strlen(text));
+
+    regexRelease(found.re);
+    regexRelease(missing.re);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Lexical analysis
+//----------------------------------------------------------------------------------------------------------------------
+
+typedef struct
+{
+    LexConfig   config;
+    StringTable symbols;
+    String      source;
+}
+LexData;
+
+internal void benchLexOutput(const i8* msg)
+{
+    fprintf(stderr, "%s", msg);
+}
+
+internal void benchLex(void* data, i64 iterations)
+{
+    LexData* ld = (LexData *)data;
+    Lex L;
+    for (i64 i = 0; i < iterations; ++i)
+    {
+        lex(&L, &ld->config, &benchLexOutput, &ld->symbols, ld->source, ld->source,
+            ld->source + stringLength(ld->source));
+        benchDoNotOptimize(L.m_info);
+        lexDone(&L);
+    }
+}
+
+internal void benchLexer(Bench* B)
+{
+    static const char* operators[] = { "+", "-", "*", "/", "=", "==", "(", ")", "{", "}", ";", ",", "<", ">" };
+    static const char* keywords[] = { "if", "else", "while", "return", "int", "float" };
+
+    LexData ld;
+    lexConfigInit(&ld.config);
+    lexConfigAddNameCharsRange(&ld.config, LNCT_Valid, 'a', 'z');
+    lexConfigAddNameCharsRange(&ld.config, LNCT_Valid, 'A', 'Z');
+    lexConfigAddNameCharsString(&ld.config, LNCT_Valid, (const i8 *)"_");
+    lexConfigAddNameCharsRange(&ld.config, LNCT_NotInitial, '0', '9');
+    for (int i = 0; i < (int)K_ARRAY_COUNT(operators); ++i)
+    {
+        lexConfigAddOperator(&ld.config, (const i8 *)operators[i]);
+    }
+    for (int i = 0; i < (int)K_ARRAY_COUNT(keywords); ++i)
+    {
+        lexConfigAddKeyword(&ld.config, (const i8 *)keywords[i]);
+    }
+    stringTableInit(&ld.symbols, K_KB(64), 1024);
+
+    // About 32K of C-like source with lots of repeated names.
+    ld.source = stringMake((const i8 *)"");
+    for (int i = 0; i < 256; ++i)
+    {
+        String line = stringFormat((const i8 *)
+            "// Function %d\n"
+            "int func_%d(int a, float b)\n"
+            "{\n"
+            "    if (a > %d) return a * 2 + b; else while (a < 10) { a = a + 1; }\n"
+            "    return func_%d(a - 1, b / 3.5);\n"
+            "}\n",
+            i, i & 31, i * 7, (i + 1) & 31);
+        ld.source = stringGrow(ld.source, line);
+        stringDone(&line);
+    }
+
+    benchSuite(B, "lex");
+    benchRun(B, "source", &benchLex, &ld, stringLength(ld.source));
+
+    stringDone(&ld.source);
+    stringTableDone(&ld.symbols);
+    lexConfigDone(&ld.config);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// PNG writing
+//----------------------------------------------------------------------------------------------------------------------
+
+typedef struct
+{
+    u32*        img;
+    int         size;
+}
+PngData;
+
+internal void benchPngWrite(void* data, i64 iterations)
+{
+    PngData* pd = (PngData *)data;
+    for (i64 i = 0; i < iterations; ++i)
+    {
+        bool ok = pngWrite("kbench.png", pd->img, pd->size, pd->size);
+        benchDoNotOptimize(&ok);
+    }
+}
+
+internal void benchPng(Bench* B)
+{
+    PngData small = { (u32 *)gBuffer, 64 };
+    PngData large = { (u32 *)gBuffer, 512 };
+
+    benchSuite(B, "pngWrite");
+    benchRun(B, "64x64", &benchPngWrite, &small, 64 * 64 * sizeof(u32));
+    benchRun(B, "512x512", &benchPngWrite, &large, 512 * 512 * sizeof(u32));
+
+    remove("kbench.png");
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Main
+//----------------------------------------------------------------------------------------------------------------------
+
+int kmain(int argc, char** argv)
+{
+    enum { BO_Text, BO_Csv, BO_Json } output = BO_Text;
+    const char* filter = 0;
+    const char* outFileName = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-csv") == 0)                       output = BO_Csv;
+        else if (strcmp(argv[i], "-json") == 0)                 output = BO_Json;
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)    outFileName = argv[++i];
+        else if (argv[i][0] != '-')                             filter = argv[i];
+        else
+        {
+            fprintf(stderr, "Usage: kbench [-csv | -json] [-o <file>] [<filter>]\n");
+            return 1;
+        }
+    }
+
+    benchDataInit();
+
+    Bench B;
+    benchInit(&B, filter);
+    benchBuffers(&B, "hash", &benchHash);
+    benchBuffers(&B, "crc32", &benchCrc32);
+    benchBuffers(&B, "sha1Add", &benchSha1);
+    benchStringTables(&B);
+    benchMemory(&B);
+    benchAllocators(&B);
+    benchHugePages(&B);
+    benchPoolContention(&B);
+    benchRegex(&B);
+    benchLexer(&B);
+    benchPng(&B);
+
+    FILE* f = outFileName ? fopen(outFileName, "w") : stdout;
+    if (!f)
+    {
+        fprintf(stderr, "kbench: cannot open %s\n", outFileName);
+        return 1;
+    }
+
+    switch (output)
+    {
+    case BO_Text:   benchWriteText(&B, f);  break;
+    case BO_Csv:    benchWriteCsv(&B, f);   break;
+    case BO_Json:   benchWriteJson(&B, f);  break;
+    }
+
+    if (f != stdout) fclose(f);
+    benchDone(&B);
+    benchDataDone();
+    return 0;
+}